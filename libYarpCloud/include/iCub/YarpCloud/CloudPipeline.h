@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email:  tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __CLOUDPIPELINE_H__
+#define __CLOUDPIPELINE_H__
+
+// Includes
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <sstream>
+
+// YARP includes
+#include <yarp/os/all.h>
+
+//PCL includes
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/filters/voxel_grid.h>
+
+#include <iCub/YarpCloud/CloudUtils.h>
+
+namespace iCub {
+    namespace YarpCloud {
+        class CloudPipeline;
+     }
+}
+
+/**
+ * @brief The iCub::YarpCloud::CloudPipeline class applies an ordered list of processing stages to a pointcloud, in place.
+ * Stages and their parameters are read from a configuration group, such as:
+ *
+ *      [pipe_filter]
+ *      stages      (rorFine ror sor)
+ *      rorFine     (type ror) (radius 0.01) (minNeigh 20) (passes 3)
+ *      ror         (radius 0.05) (minNeigh 50)
+ *      sor         (meanK 10) (stdMul 3.0)
+ *
+ * Each name on 'stages' refers to the group with its parameters. The stage type is given by its 'type' parameter, or by its name if not given:
+ *  - crop:  (min x y z) (max x y z) (sphereRad r)   -> CloudUtils::cropCloud
+ *  - ror:   (radius r) (minNeigh n) (passes p)      -> CloudUtils::radOutlierRemoval, repeated up to p times while it removes points
+ *  - sor:   (meanK k) (stdMul s)                    -> CloudUtils::statOutlierRemoval
+ *  - mls:   (radius r) (usRad u) (usStep s) (maxPoints m) (order o) -> CloudUtils::mlsSmooth
+ *  - ds:    (res r)                                 -> voxel grid downsampling
+ * Missing parameters take the default values shown in CloudPipeline.cpp.
+ * Wall time and point counts of each stage are recorded on every run.
+ * As buffers are reused between runs, a pipeline should not be run from different threads at the same time.
+ */
+class iCub::YarpCloud::CloudPipeline {
+
+public:
+
+    /**
+     * @brief The StageStats struct keeps the record of the last run of a stage.
+     */
+    struct StageStats {
+        std::string name;
+        bool        run;
+        int         pointsIn;
+        int         pointsOut;
+        double      time;
+    };
+
+    CloudPipeline();
+
+    /**
+     * @brief configure Builds the list of stages from a configuration group (see class description).
+     * @param config   Group (ini file section or Bottle) containing the 'stages' list and the parameters of each stage.
+     * @return true if all the stages are of a known type.
+     */
+    bool        configure(const yarp::os::Searchable &config);
+
+    /**
+     * @brief configure Builds the list of stages from the group 'groupName' of the given configuration, or from 'defaultConfig' if the group is not found.
+     * @param rf            Configuration (typically the ResourceFinder of the module)
+     * @param groupName     Name of the group where the pipeline is defined.
+     * @param defaultConfig Pipeline definition to use if the group is not found, in Bottle format, e.g. "(stages (sor)) (sor (meanK 10) (stdMul 3.0))"
+     * @return true if all the stages are of a known type.
+     */
+    bool        configure(const yarp::os::Searchable &rf, const std::string &groupName, const std::string &defaultConfig);
+
+    /**
+     * @brief process Applies all the enabled stages, in order, to the given cloud.
+     * @param cloud Boost pointer to the cloud to process (modified in place)
+     * @return true on success.
+     */
+    bool        process(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud);
+
+    /**
+     * @brief setStageEnabled Enables or disables all the stages of the given type (or name).
+     * @param stage Type or name of the stage(s)
+     * @param enabled true to enable, false to disable
+     * @return true if any stage matched.
+     */
+    bool        setStageEnabled(const std::string &stage, bool enabled);
+
+    /**
+     * @brief setVerbose Sets whether the stats of each run are printed.
+     */
+    void        setVerbose(bool verb) { verbose = verb; }
+
+    /**
+     * @brief getStats Returns the record of the last run of each stage.
+     */
+    const std::vector<StageStats>& getStats() const { return stats; }
+
+    /**
+     * @brief getStats Writes the record of the last run as a list of (name pointsIn pointsOut time) per stage.
+     */
+    void        getStats(yarp::os::Bottle &statsB) const;
+
+    /**
+     * @brief printStats Prints the record of the last run of each stage.
+     */
+    void        printStats() const;
+
+    /**
+     * @brief toString Returns a readable description of the configured stages.
+     */
+    std::string toString() const;
+
+protected:
+    enum StageType { STAGE_CROP, STAGE_ROR, STAGE_SOR, STAGE_MLS, STAGE_DS };
+
+    struct Stage {
+        std::string     name;
+        StageType       type;
+        bool            enabled;
+        Eigen::Vector3f boxMin;
+        Eigen::Vector3f boxMax;
+        double          sphereRad;
+        double          radius;
+        int             minNeigh;
+        int             passes;
+        int             meanK;
+        double          stdMul;
+        double          usRad;
+        double          usStep;
+        int             maxPoints;
+        int             order;
+        double          res;
+    };
+
+    std::vector<Stage>                          stages;
+    std::vector<StageStats>                     stats;
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr      buffer;         // Output of stages that can not work in place, reused between stages and runs.
+    bool                                        verbose;
+
+    bool        parseStage(const std::string &name, const yarp::os::Bottle &params, Stage &stage);
+    static std::string typeName(StageType type);
+};
+
+#endif //__CLOUDPIPELINE_H__
+
@@ -36,6 +36,9 @@
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
 #include <pcl/filters/voxel_grid.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/common/eigen.h>
+#include <Eigen/Dense>
 #include "pcl/common/impl/centroid.hpp"
 //#include <pcl/features/moment_of_inertia_estimation.h>
 
@@ -154,7 +157,64 @@ public:
      * @param scale  (double) scaling factor
      */
     static bool        scaleCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_scaled, double scale);
-        
+
+    /**
+     * @brief cropCloud Removes, in a single pass and in place, all the points which are NaN, lie outside the given axis-aligned box, or lie within a sphere around the origin (e.g. the hand).
+     * @param cloud      Boost pointer to the cloud to be cropped (modified in place)
+     * @param boxMin     Minimum (x,y,z) coordinates of the box where points are kept
+     * @param boxMax     Maximum (x,y,z) coordinates of the box where points are kept
+     * @param sphereRad  (double) radius around the origin within which points are removed. Negative to keep them (default).
+     * @return Number of points left on the cloud.
+     */
+    static int         cropCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const Eigen::Vector3f &boxMin, const Eigen::Vector3f &boxMax, double sphereRad = -1.0);
+
+    /**
+     * @brief cropCloud Crops the cloud as above, with the box and sphere given in the frame the cloud is transformed to by the rigid transformation TM.
+     * Box and sphere are brought to the frame of the input cloud once, so that most points are rejected before being transformed, and only the remaining ones are transformed by TM.
+     * @param cloud      Boost pointer to the cloud to be cropped and transformed (modified in place)
+     * @param TM         Rigid transformation (rotation and translation) to apply to the cloud.
+     * @param boxMin     Minimum (x,y,z) coordinates of the box where points are kept, in the transformed frame
+     * @param boxMax     Maximum (x,y,z) coordinates of the box where points are kept, in the transformed frame
+     * @param sphereRad  (double) radius around the origin of the transformed frame within which points are removed. Negative to keep them (default).
+     * @return Number of points left on the cloud.
+     */
+    static int         cropCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const Eigen::Matrix4f &TM, const Eigen::Vector3f &boxMin, const Eigen::Vector3f &boxMax, double sphereRad = -1.0);
+
+    /**
+     * @brief statOutlierRemoval Multithreaded statistical outlier removal. Removes the points whose mean distance to their meanK nearest neighbors is above the mean by more than stdMul standard deviations (as pcl::StatisticalOutlierRemoval). Also removes NaNs.
+     * @param cloud_in   Boost pointer to cloud to be filtered
+     * @param cloud_out  Boost pointer to filtered cloud (can be the same as cloud_in, in which case the cloud is filtered in place)
+     * @param meanK      (int) number of neighbors considered for the mean distance of each point
+     * @param stdMul     (double) number of standard deviations above the mean distance over which points are removed
+     */
+    static bool        statOutlierRemoval(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, int meanK = 10, double stdMul = 3.0);
+
+    /**
+     * @brief radOutlierRemoval Multithreaded radius outlier removal. Removes the points with less than minNeigh neighbors within 'radius' (as pcl::RadiusOutlierRemoval). Also removes NaNs.
+     * @param cloud_in   Boost pointer to cloud to be filtered
+     * @param cloud_out  Boost pointer to filtered cloud (can be the same as cloud_in, in which case the cloud is filtered in place)
+     * @param radius     (double) radius of the neighborhood of each point
+     * @param minNeigh   (int) minimum number of neighbors (not counting the point itself) a point needs to have within 'radius' to be kept
+     */
+    static bool        radOutlierRemoval(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, double radius, int minNeigh);
+
+    /**
+     * @brief mlsSmooth Multithreaded Moving Least Squares smoothing, with a local plane (first order) or polynomial (second order) fit
+     * and optional upsampling of the fitted surface on a grid of the local plane.
+     * Works directly on XYZRGB clouds, and every output point keeps the color of the point it was computed from.
+     * @param cloud_in   Boost pointer to cloud to be smoothed
+     * @param cloud_out  Boost pointer to smoothed cloud (must be different from cloud_in)
+     * @param searchRad  (double) radius of the neighborhood used to fit the local plane of each point
+     * @param usRad      (double) radius around each point within which the local plane is upsampled. 0 to disable upsampling (default).
+     * @param usStep     (double) step size of the upsampling grid. 0 to disable upsampling (default).
+     * @param maxPoints  (int) maximum number of points on the output cloud. Upsampled points are evenly thinned out to meet it, while the smoothed
+     *                   input points are always kept (so the output can only exceed it if the input alone does). 0 for no limit (default).
+     * @param order      (int) order of the fit: 1 for the local plane (default), 2 for a second order polynomial over it (as PCL's default).
+     * @param tree       (optional) search index already built on cloud_in, to be reused. A new one is built if not given.
+     */
+    static bool        mlsSmooth(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, double searchRad, double usRad = 0.0, double usStep = 0.0, int maxPoints = 0,
+                                 int order = 1, pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree = pcl::search::KdTree<pcl::PointXYZRGB>::Ptr());
+
 
 
 
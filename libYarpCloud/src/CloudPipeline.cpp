@@ -0,0 +1,255 @@
+
+#include <iCub/YarpCloud/CloudPipeline.h>
+
+using namespace std;
+using namespace yarp::os;
+using namespace iCub::YarpCloud;
+
+/************************************************************************/
+CloudPipeline::CloudPipeline()
+{
+    buffer = pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB> ());
+    verbose = false;
+}
+
+/************************************************************************/
+bool CloudPipeline::configure(const Searchable &rf, const string &groupName, const string &defaultConfig)
+{
+    Bottle &group = rf.findGroup(groupName.c_str());
+    if (!group.isNull())
+        return configure(group);
+
+    Bottle defaults;
+    defaults.fromString(defaultConfig.c_str());
+    return configure(defaults);
+}
+
+/************************************************************************/
+bool CloudPipeline::configure(const Searchable &config)
+{
+    stages.clear();
+    stats.clear();
+
+    Bottle *stageList = config.find("stages").asList();
+    if (stageList == NULL){
+        cout << "No 'stages' list found on the pipeline configuration: " << config.toString() << endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < stageList->size(); i++)
+    {
+        string name = stageList->get(i).asString();
+        Stage stage;
+        if (parseStage(name, config.findGroup(name.c_str()), stage)){
+            stages.push_back(stage);
+        }else{
+            cout << "Unknown type of pipeline stage '" << name << "', skipping it." << endl;
+            ok = false;
+        }
+    }
+
+    stats.resize(stages.size());
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        stats[i].name = stages[i].name;
+        stats[i].run = false;
+        stats[i].pointsIn = 0;
+        stats[i].pointsOut = 0;
+        stats[i].time = 0.0;
+    }
+
+    if (verbose){ cout << "Pipeline configured: " << toString() << endl;}
+
+    return ok;
+}
+
+/************************************************************************/
+bool CloudPipeline::parseStage(const string &name, const Bottle &params, Stage &stage)
+{
+    string type = params.check("type", Value(name.c_str())).asString();
+    if (type == "crop")         stage.type = STAGE_CROP;
+    else if (type == "ror")     stage.type = STAGE_ROR;
+    else if (type == "sor")     stage.type = STAGE_SOR;
+    else if (type == "mls")     stage.type = STAGE_MLS;
+    else if (type == "ds")      stage.type = STAGE_DS;
+    else return false;
+
+    stage.name = name;
+    stage.enabled = true;
+
+    // Crop parameters. By default, nothing is cropped.
+    stage.boxMin = Eigen::Vector3f(-1e9, -1e9, -1e9);
+    stage.boxMax = Eigen::Vector3f( 1e9,  1e9,  1e9);
+    Bottle *minB = params.find("min").asList();
+    Bottle *maxB = params.find("max").asList();
+    if ((minB != NULL) && (minB->size() == 3))
+        stage.boxMin = Eigen::Vector3f(minB->get(0).asDouble(), minB->get(1).asDouble(), minB->get(2).asDouble());
+    if ((maxB != NULL) && (maxB->size() == 3))
+        stage.boxMax = Eigen::Vector3f(maxB->get(0).asDouble(), maxB->get(1).asDouble(), maxB->get(2).asDouble());
+    stage.sphereRad = params.check("sphereRad", Value(-1.0)).asDouble();
+
+    // Outlier removal parameters
+    stage.radius = params.check("radius", Value(stage.type == STAGE_MLS ? 0.02 : 0.05)).asDouble();
+    stage.minNeigh = params.check("minNeigh", Value(5)).asInt();
+    stage.passes = params.check("passes", Value(1)).asInt();
+    stage.meanK = params.check("meanK", Value(10)).asInt();
+    stage.stdMul = params.check("stdMul", Value(3.0)).asDouble();
+
+    // Smoothing and downsampling parameters
+    stage.usRad = params.check("usRad", Value(0.0)).asDouble();
+    stage.usStep = params.check("usStep", Value(0.0)).asDouble();
+    stage.maxPoints = params.check("maxPoints", Value(0)).asInt();
+    stage.order = params.check("order", Value(1)).asInt();
+    stage.res = params.check("res", Value(0.002)).asDouble();
+
+    return true;
+}
+
+/************************************************************************/
+bool CloudPipeline::process(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud)
+{
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const Stage &stage = stages[i];
+        StageStats &stat = stats[i];
+        stat.run = stage.enabled;
+        stat.pointsIn = cloud->points.size();
+        stat.pointsOut = stat.pointsIn;
+        stat.time = 0.0;
+        if (!stage.enabled)
+            continue;
+
+        double t0 = Time::now();
+        switch (stage.type)
+        {
+        case STAGE_CROP:
+            CloudUtils::cropCloud(cloud, stage.boxMin, stage.boxMax, stage.sphereRad);
+            break;
+
+        case STAGE_ROR:
+            for (int p = 0; p < stage.passes; p++){
+                size_t sizePrev = cloud->points.size();
+                CloudUtils::radOutlierRemoval(cloud, cloud, stage.radius, stage.minNeigh);
+                if (cloud->points.size() == sizePrev)
+                    break;
+            }
+            break;
+
+        case STAGE_SOR:
+            CloudUtils::statOutlierRemoval(cloud, cloud, stage.meanK, stage.stdMul);
+            break;
+
+        case STAGE_MLS:
+            CloudUtils::mlsSmooth(cloud, buffer, stage.radius, stage.usRad, stage.usStep, stage.maxPoints, stage.order);
+            cloud->swap(*buffer);
+            break;
+
+        case STAGE_DS:
+        {
+            pcl::VoxelGrid<pcl::PointXYZRGB> vg;
+            vg.setInputCloud(cloud);
+            vg.setLeafSize(stage.res, stage.res, stage.res);
+            vg.filter(*buffer);
+            cloud->swap(*buffer);
+            break;
+        }
+        }
+        stat.time = Time::now() - t0;
+        stat.pointsOut = cloud->points.size();
+    }
+
+    if (verbose)
+        printStats();
+
+    return true;
+}
+
+/************************************************************************/
+bool CloudPipeline::setStageEnabled(const string &stage, bool enabled)
+{
+    bool found = false;
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        if ((stages[i].name == stage) || (typeName(stages[i].type) == stage)){
+            stages[i].enabled = enabled;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/************************************************************************/
+void CloudPipeline::getStats(Bottle &statsB) const
+{
+    statsB.clear();
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        if (!stats[i].run)
+            continue;
+        Bottle &stageB = statsB.addList();
+        stageB.addString(stats[i].name);
+        stageB.addInt(stats[i].pointsIn);
+        stageB.addInt(stats[i].pointsOut);
+        stageB.addDouble(stats[i].time);
+    }
+}
+
+/************************************************************************/
+void CloudPipeline::printStats() const
+{
+    double total = 0.0;
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        if (!stats[i].run)
+            continue;
+        printf("-- Stage %-12s: %7d -> %7d points in %7.2f ms \n", stats[i].name.c_str(), stats[i].pointsIn, stats[i].pointsOut, stats[i].time*1000.0);
+        total += stats[i].time;
+    }
+    printf("-- Pipeline total: %.2f ms \n", total*1000.0);
+}
+
+/************************************************************************/
+string CloudPipeline::toString() const
+{
+    ostringstream desc;
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const Stage &stage = stages[i];
+        desc << "(" << stage.name << " " << typeName(stage.type);
+        switch (stage.type)
+        {
+        case STAGE_CROP:
+            desc << " min " << stage.boxMin.transpose() << " max " << stage.boxMax.transpose() << " sphereRad " << stage.sphereRad;
+            break;
+        case STAGE_ROR:
+            desc << " radius " << stage.radius << " minNeigh " << stage.minNeigh << " passes " << stage.passes;
+            break;
+        case STAGE_SOR:
+            desc << " meanK " << stage.meanK << " stdMul " << stage.stdMul;
+            break;
+        case STAGE_MLS:
+            desc << " radius " << stage.radius << " usRad " << stage.usRad << " usStep " << stage.usStep << " maxPoints " << stage.maxPoints << " order " << stage.order;
+            break;
+        case STAGE_DS:
+            desc << " res " << stage.res;
+            break;
+        }
+        desc << (stage.enabled ? "" : " disabled") << ") ";
+    }
+    return desc.str();
+}
+
+/************************************************************************/
+string CloudPipeline::typeName(StageType type)
+{
+    switch (type)
+    {
+    case STAGE_CROP:    return "crop";
+    case STAGE_ROR:     return "ror";
+    case STAGE_SOR:     return "sor";
+    case STAGE_MLS:     return "mls";
+    case STAGE_DS:      return "ds";
+    }
+    return "unknown";
+}
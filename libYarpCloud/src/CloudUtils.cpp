@@ -432,3 +432,371 @@ bool CloudUtils::scaleCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_i
 
 
 
+
+/************************************************************************/
+int CloudUtils::cropCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const Eigen::Vector3f &boxMin, const Eigen::Vector3f &boxMax, double sphereRad)
+{
+    // NaN, box and sphere checks are fused in a single branchless predicate, and the points that pass it are compacted in place.
+    // Comparisons with NaN are always false, so NaN points never pass the box check.
+    const float minX = boxMin[0];   const float maxX = boxMax[0];
+    const float minY = boxMin[1];   const float maxY = boxMax[1];
+    const float minZ = boxMin[2];   const float maxZ = boxMax[2];
+    const float sqRad = (sphereRad > 0.0) ? (float)(sphereRad*sphereRad) : -1.0f;
+
+    size_t numPoints = cloud->points.size();
+    size_t kept = 0;
+    for (size_t i = 0; i < numPoints; i++)
+    {
+        const pcl::PointXYZRGB point = cloud->points[i];
+        int keep = (point.x >= minX) & (point.x <= maxX) &
+                   (point.y >= minY) & (point.y <= maxY) &
+                   (point.z >= minZ) & (point.z <= maxZ) &
+                   (point.x*point.x + point.y*point.y + point.z*point.z > sqRad);
+        cloud->points[kept] = point;
+        kept += keep;
+    }
+
+    cloud->points.resize(kept);
+    cloud->width = kept;
+    cloud->height = 1;
+    cloud->is_dense = true;
+
+    return (int)kept;
+}
+
+/************************************************************************/
+int CloudUtils::cropCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const Eigen::Matrix4f &TM, const Eigen::Vector3f &boxMin, const Eigen::Vector3f &boxMax, double sphereRad)
+{
+    const Eigen::Matrix3f R = TM.block<3,3>(0,0);
+    const Eigen::Vector3f t = TM.block<3,1>(0,3);
+
+    // Bring the box and the sphere to the frame of the input cloud. As TM is rigid, its inverse is [R' | -R't]
+    const Eigen::Matrix3f Rinv = R.transpose();
+    const Eigen::Vector3f tinv = -Rinv*t;
+    Eigen::Vector3f srcMin, srcMax;
+    for (int c = 0; c < 8; c++)
+    {
+        Eigen::Vector3f corner((c & 1) ? boxMax[0] : boxMin[0],
+                               (c & 2) ? boxMax[1] : boxMin[1],
+                               (c & 4) ? boxMax[2] : boxMin[2]);
+        Eigen::Vector3f cornerSrc = Rinv*corner + tinv;
+        if (c == 0){
+            srcMin = cornerSrc;
+            srcMax = cornerSrc;
+        }else{
+            srcMin = srcMin.cwiseMin(cornerSrc);
+            srcMax = srcMax.cwiseMax(cornerSrc);
+        }
+    }
+    const Eigen::Vector3f center = tinv;    // Origin of the transformed frame, in the input frame
+    const float sqRad = (sphereRad > 0.0) ? (float)(sphereRad*sphereRad) : -1.0f;
+
+    size_t numPoints = cloud->points.size();
+    size_t kept = 0;
+    for (size_t i = 0; i < numPoints; i++)
+    {
+        pcl::PointXYZRGB point = cloud->points[i];
+
+        // Cheap rejection on the input frame: bounding box of the transformed box, and distance to the sphere center (preserved by rigid transformations).
+        const float dx = point.x - center[0];
+        const float dy = point.y - center[1];
+        const float dz = point.z - center[2];
+        int keep = (point.x >= srcMin[0]) & (point.x <= srcMax[0]) &
+                   (point.y >= srcMin[1]) & (point.y <= srcMax[1]) &
+                   (point.z >= srcMin[2]) & (point.z <= srcMax[2]) &
+                   (dx*dx + dy*dy + dz*dz > sqRad);
+
+        // Only surviving points are transformed, and checked against the actual box.
+        if (keep)
+        {
+            Eigen::Vector3f pt = R*point.getVector3fMap() + t;
+            keep = (pt[0] >= boxMin[0]) & (pt[0] <= boxMax[0]) &
+                   (pt[1] >= boxMin[1]) & (pt[1] <= boxMax[1]) &
+                   (pt[2] >= boxMin[2]) & (pt[2] <= boxMax[2]);
+            point.x = pt[0];
+            point.y = pt[1];
+            point.z = pt[2];
+        }
+        cloud->points[kept] = point;
+        kept += keep;
+    }
+
+    cloud->points.resize(kept);
+    cloud->width = kept;
+    cloud->height = 1;
+    cloud->is_dense = true;
+
+    return (int)kept;
+}
+
+/************************************************************************/
+// Copies the points of cloud_in flagged in keep onto cloud_out, which can be the same cloud (in place compaction).
+static void compactCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, const std::vector<char> &keep)
+{
+    size_t numPoints = cloud_in->points.size();
+    if (cloud_out.get() != cloud_in.get()){
+        cloud_out->header = cloud_in->header;
+        cloud_out->sensor_origin_ = cloud_in->sensor_origin_;
+        cloud_out->sensor_orientation_ = cloud_in->sensor_orientation_;
+        cloud_out->points.resize(numPoints);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < numPoints; i++)
+    {
+        if (keep[i]){
+            cloud_out->points[kept] = cloud_in->points[i];
+            kept++;
+        }
+    }
+
+    cloud_out->points.resize(kept);
+    cloud_out->width = kept;
+    cloud_out->height = 1;
+    cloud_out->is_dense = true;
+}
+
+/************************************************************************/
+bool CloudUtils::statOutlierRemoval(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, int meanK, double stdMul)
+{
+    int numPoints = (int)cloud_in->points.size();
+    std::vector<char> keep(numPoints, 0);
+    std::vector<float> meanDist(numPoints, 0.0f);
+
+    if ((numPoints == 0) || (meanK < 1)){
+        compactCloud(cloud_in, cloud_out, keep);
+        return false;
+    }
+
+    pcl::search::KdTree<pcl::PointXYZRGB> tree(false);
+    tree.setInputCloud(cloud_in);
+
+    // kNN queries are split in batches among threads, each one with its own result buffers.
+    #pragma omp parallel
+    {
+        std::vector<int> nnIdx(meanK + 1);
+        std::vector<float> nnSqDist(meanK + 1);
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < numPoints; i++)
+        {
+            if (!pcl::isFinite(cloud_in->points[i]))
+                continue;
+            int found = tree.nearestKSearch(cloud_in->points[i], meanK + 1, nnIdx, nnSqDist);
+            if (found < 2)      // The first neighbor is the point itself
+                continue;
+            double distSum = 0.0;
+            for (int k = 1; k < found; k++)
+                distSum += sqrt(nnSqDist[k]);
+            meanDist[i] = (float)(distSum/(found - 1));
+            keep[i] = 1;
+        }
+    }
+
+    // Mean and standard deviation of the mean distances, over the valid points
+    double sum = 0.0, sqSum = 0.0;
+    int valid = 0;
+    for (int i = 0; i < numPoints; i++)
+    {
+        if (keep[i]){
+            sum += meanDist[i];
+            sqSum += meanDist[i]*meanDist[i];
+            valid++;
+        }
+    }
+    if (valid > 1){
+        double mean = sum/valid;
+        double variance = (sqSum - sum*sum/valid)/(valid - 1);
+        double threshold = mean + stdMul*sqrt(std::max(variance, 0.0));
+        for (int i = 0; i < numPoints; i++)
+            keep[i] = keep[i] && (meanDist[i] <= threshold);
+    }
+
+    compactCloud(cloud_in, cloud_out, keep);
+    return true;
+}
+
+/************************************************************************/
+bool CloudUtils::radOutlierRemoval(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, double radius, int minNeigh)
+{
+    int numPoints = (int)cloud_in->points.size();
+    std::vector<char> keep(numPoints, 0);
+
+    if ((numPoints == 0) || (radius <= 0.0)){
+        compactCloud(cloud_in, cloud_out, keep);
+        return false;
+    }
+
+    pcl::search::KdTree<pcl::PointXYZRGB> tree(false);
+    tree.setInputCloud(cloud_in);
+
+    // Radius queries are split in batches among threads. As only the number of neighbors matters,
+    // each search stops as soon as enough neighbors are found (the point itself is returned too).
+    #pragma omp parallel
+    {
+        std::vector<int> nnIdx;
+        std::vector<float> nnSqDist;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < numPoints; i++)
+        {
+            if (!pcl::isFinite(cloud_in->points[i]))
+                continue;
+            int found = tree.radiusSearch(cloud_in->points[i], radius, nnIdx, nnSqDist, minNeigh + 1);
+            keep[i] = (found > minNeigh);
+        }
+    }
+
+    compactCloud(cloud_in, cloud_out, keep);
+    return true;
+}
+
+/************************************************************************/
+bool CloudUtils::mlsSmooth(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, double searchRad, double usRad, double usStep, int maxPoints,
+                           int order, pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree)
+{
+    cloud_out->points.clear();
+    cloud_out->header = cloud_in->header;
+
+    int numPoints = (int)cloud_in->points.size();
+    if ((numPoints == 0) || (searchRad <= 0.0)){
+        cloud_out->width = 0;
+        cloud_out->height = 1;
+        return false;
+    }
+
+    if (!tree){
+        tree = pcl::search::KdTree<pcl::PointXYZRGB>::Ptr(new pcl::search::KdTree<pcl::PointXYZRGB>(false));
+        tree->setInputCloud(cloud_in);
+    }
+
+    // Offsets (u,v) on the local plane at which each point is upsampled, without the grid points that would fall on top of the point itself.
+    std::vector<Eigen::Vector2f> offsets;
+    if ((usRad > 0.0) && (usStep > 0.0)){
+        for (double u = -usRad; u <= usRad; u += usStep)
+            for (double v = -usRad; v <= usRad; v += usStep)
+                if ((u*u + v*v < usRad*usRad) && (u*u + v*v >= 0.25*usStep*usStep))
+                    offsets.push_back(Eigen::Vector2f(u, v));
+    }
+    // Projected points are always kept. If there is no room left for upsampled ones, none are computed.
+    if ((maxPoints > 0) && (numPoints >= maxPoints))
+        offsets.clear();
+    const int numOffsets = (int)offsets.size();
+
+    // If the output would be too large, keep only every 'stride'-th upsampled sample, numbered as j = i*numOffsets + k.
+    int stride = 1;
+    const int numUpsampled = numPoints*numOffsets;
+    if ((maxPoints > 0) && (numUpsampled > 0) && (numPoints + numUpsampled > maxPoints)){
+        int room = maxPoints - numPoints;
+        stride = (numUpsampled + room - 1)/room;
+    }
+
+    // Each point writes its projection and its kept upsampled samples (j/stride) on their own slots, so threads never share them,
+    // and only the samples kept are allocated.
+    pcl::PointCloud<pcl::PointXYZRGB>::VectorType projected(numPoints);
+    pcl::PointCloud<pcl::PointXYZRGB>::VectorType upsampled((numUpsampled + stride - 1)/stride);
+    std::vector<char> valid(numPoints, 0);
+    const float sqGauss = (float)(searchRad*searchRad);
+
+    #pragma omp parallel
+    {
+        std::vector<int> nnIdx;
+        std::vector<float> nnSqDist;
+        std::vector<float> weights;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < numPoints; i++)
+        {
+            const pcl::PointXYZRGB &query = cloud_in->points[i];
+            if (!pcl::isFinite(query))
+                continue;
+            int found = tree->radiusSearch(query, searchRad, nnIdx, nnSqDist);
+            if (found < 3)      // Not enough neighbors to fit a plane.
+                continue;
+
+            // Gaussian weighted mean and covariance of the neighborhood
+            Eigen::Vector3f mean = Eigen::Vector3f::Zero();
+            double weightSum = 0.0;
+            weights.resize(found);
+            for (int k = 0; k < found; k++)
+            {
+                weights[k] = exp(-nnSqDist[k]/sqGauss);
+                mean += weights[k]*cloud_in->points[nnIdx[k]].getVector3fMap();
+                weightSum += weights[k];
+            }
+            mean /= (float)weightSum;
+
+            Eigen::Matrix3f cov = Eigen::Matrix3f::Zero();
+            for (int k = 0; k < found; k++)
+            {
+                Eigen::Vector3f d = cloud_in->points[nnIdx[k]].getVector3fMap() - mean;
+                cov += weights[k]*(d*d.transpose());
+            }
+
+            // The local plane normal is the eigenvector with the smallest eigenvalue (eigen33 sorts them in increasing order).
+            Eigen::Matrix3f eigVecs;
+            Eigen::Vector3f eigVals;
+            pcl::eigen33(cov, eigVecs, eigVals);
+            const Eigen::Vector3f normal = eigVecs.col(0);
+            const Eigen::Vector3f axisU = eigVecs.col(2);
+            const Eigen::Vector3f axisV = eigVecs.col(1);
+
+            // Second order: weighted least squares fit of the height over the plane, w = c0 + c1 u + c2 v + c3 u^2 + c4 uv + c5 v^2.
+            // Falls back on the plane if there are not enough neighbors to constrain it.
+            Eigen::Matrix<double,6,1> coefs = Eigen::Matrix<double,6,1>::Zero();
+            if ((order >= 2) && (found >= 6)){
+                Eigen::Matrix<double,6,6> M = Eigen::Matrix<double,6,6>::Zero();
+                Eigen::Matrix<double,6,1> b = Eigen::Matrix<double,6,1>::Zero();
+                for (int k = 0; k < found; k++)
+                {
+                    Eigen::Vector3f d = cloud_in->points[nnIdx[k]].getVector3fMap() - mean;
+                    double u = d.dot(axisU), v = d.dot(axisV), w = d.dot(normal);
+                    Eigen::Matrix<double,6,1> m;
+                    m << 1.0, u, v, u*u, u*v, v*v;
+                    M += (double)weights[k]*(m*m.transpose());
+                    b += (weights[k]*w)*m;
+                }
+                Eigen::ColPivHouseholderQR<Eigen::Matrix<double,6,6> > qr(M);
+                if (qr.rank() == 6)
+                    coefs = qr.solve(b);
+            }
+
+            // Project the point onto the fitted surface, and sample the surface around it
+            Eigen::Vector3f dq = query.getVector3fMap() - mean;
+            const double uq = dq.dot(axisU), vq = dq.dot(axisV);
+            pcl::PointXYZRGB &proj = projected[i];
+            proj = query;
+            proj.getVector3fMap() = mean + (float)uq*axisU + (float)vq*axisV
+                                    + (float)(coefs[0] + coefs[1]*uq + coefs[2]*vq + coefs[3]*uq*uq + coefs[4]*uq*vq + coefs[5]*vq*vq)*normal;
+            for (int k = 0; k < numOffsets; k++)
+            {
+                int j = i*numOffsets + k;
+                if (j % stride != 0)
+                    continue;
+                const double u = uq + offsets[k][0], v = vq + offsets[k][1];
+                pcl::PointXYZRGB &sample = upsampled[j/stride];
+                sample = query;
+                sample.getVector3fMap() = mean + (float)u*axisU + (float)v*axisV
+                                          + (float)(coefs[0] + coefs[1]*u + coefs[2]*v + coefs[3]*u*u + coefs[4]*u*v + coefs[5]*v*v)*normal;
+            }
+            valid[i] = 1;
+        }
+    }
+
+    // Gather the samples of the valid points: every projected point, followed by its upsampled ones kept.
+    cloud_out->points.reserve(numPoints + upsampled.size());
+    for (int i = 0; i < numPoints; i++)
+    {
+        if (!valid[i])
+            continue;
+        cloud_out->points.push_back(projected[i]);
+        for (int j = ((i*numOffsets + stride - 1)/stride)*stride; j < (i + 1)*numOffsets; j += stride)
+            cloud_out->points.push_back(upsampled[j/stride]);
+    }
+
+    cloud_out->width = cloud_out->points.size();
+    cloud_out->height = 1;
+    cloud_out->is_dense = true;
+
+    return true;
+}
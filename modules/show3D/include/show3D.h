@@ -48,6 +48,31 @@
     PUBLIC METHODS
 /**********************************************************/
 
+/**********************************************************/
+class CloudReceiver : public yarp::os::BufferedPort<yarp::os::Bottle>
+{   // Port that passes the received clouds to the visualizer as soon as they arrive.
+protected:
+    VisThread *visThrd;
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud; // Point cloud
+
+public:
+    CloudReceiver();
+    void setVisualizer(VisThread *_visThrd) { visThrd = _visThrd; }
+    virtual void onRead(yarp::os::Bottle &cloudBottle);
+};
+
+/**********************************************************/
+class DrawReceiver : public yarp::os::BufferedPort<yarp::os::Bottle>
+{   // Port that passes the received batches of drawing commands to the visualizer, applied in order.
+protected:
+    VisThread *visThrd;
+
+public:
+    DrawReceiver();
+    void setVisualizer(VisThread *_visThrd) { visThrd = _visThrd; }
+    virtual void onRead(yarp::os::Bottle &batch);
+};
+
 /**********************************************************/
 class ShowModule : public yarp::os::RFModule, public show3D_IDLServer
 {
@@ -56,12 +81,12 @@ protected:
     yarp::os::RpcServer handlerPort;  // port to handle incoming commands
     VisThread *visThrd;
 
-    yarp::os::BufferedPort<yarp::os::Bottle> cloudsInPort; // Buffered port to receive clouds.
+    CloudReceiver cloudsInPort; // Buffered port to receive clouds.
+    DrawReceiver drawInPort;    // Buffered port to receive batches of drawing commands.
 
     std::string cloudpath; //path to folder with .ply files
     std::string cloudfile; //name of the .ply file to show
 
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud; // Point cloud
     bool closing;
 
 public:
@@ -77,6 +102,8 @@ public:
     bool addArrow(const std::vector<double> &coordsIni, const std::vector<double> &coordsEnd, const std::vector<int> &color);
     bool filter(bool ror, bool sor, bool mls, bool ds);
     bool saveIm(const std::string &name);
+    bool drawBatch(const yarp::os::Bottle &batch);
+    bool sync(int seq, double timeout, const std::string &port);
 
     // module control //
     bool						attach(yarp::os::RpcServer &source);
@@ -25,15 +25,19 @@
 #include <math.h> 
 #include <string>
 #include <sstream>
+#include <vector>
+#include <map>
 
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Network.h>
 #include <yarp/os/Time.h>
+#include <yarp/os/Bottle.h>
 
 #include <pcl/io/io.h>
 #include <pcl/io/ply_io.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/point_types.h>
+#include <pcl/common/transforms.h>
 #include <pcl/visualization/pcl_visualizer.h>
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/moment_of_inertia_estimation.h>
@@ -47,6 +51,9 @@
 #include <pcl/keypoints/uniform_sampling.h>
 #include <pcl/surface/mls.h>
 
+#include "iCub/YarpCloud/CloudUtils.h"
+#include "iCub/YarpCloud/CloudPipeline.h"
+
 
 class VisThread: public yarp::os::RateThread
 {
@@ -75,8 +82,6 @@ protected:
     bool displayFilt;
     bool normalsComputed;
     bool displayBB;
-    bool displaySphere;
-    bool displayArrow;
     bool getIm;
 
     // Processing parameters
@@ -90,19 +95,39 @@ protected:
     bool dFsor;
     bool dFmls;
     bool dFds;
+    iCub::YarpCloud::CloudPipeline filterPipe;
+
+    // Shapes requested since the last update cycle, plotted in order of arrival
+    struct Shape {
+        std::vector<double> coordsIni;
+        std::vector<double> coordsEnd;  // only for arrows
+        int color[3];
+    };
+    std::vector<Shape> spheres;
+    std::vector<Shape> arrows;
+    int sphereNum;
+    int arrowNum;
 
-    int sphColor[3];
-    std::vector<double> sphCoords;
+    // Clouds received with an id, kept so that later updates (color, pose) only need to refer to them
+    struct CachedCloud {
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;
+        int version;
+    };
+    std::map<std::string, CachedCloud> cachedClouds;
 
-    int arrowColor[3];
-    std::vector<double> arrowCoordsIni;
-    std::vector<double> arrowCoordsEnd;
-    int arrowNum;
+    // Sequence numbers (port envelope count) of the last message received and of the last one displayed, for each port,
+    // as clouds:i and draw:i are numbered independently by their senders
+    int cloudSeq;
+    int drawnCloudSeq;
+    int batchSeq;
+    int drawnBatchSeq;
 
     std::string imName;
 
     
     void updateVis();
+    void clearData();
+    void setCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in);
     void plotNewCloud();
     void plotBB(int typeBB = 2);
     void plotSphere(const std::vector<double> &coords, const int color[]);
@@ -121,6 +146,12 @@ public:
     // RELEASE
     virtual void threadRelease();
 
+    /**
+     * @brief configureFilter - Sets the filtering stages and parameters from the 'pipe_vis' group of the configuration, or defaults if not found.
+     * @param rf - configuration of the module.
+     */
+    void configureFilter(const yarp::os::Searchable &rf);
+
     /**
      * @brief addNormals - Sets flow to allow normals to be computed and displayed on the visualizer.
      * @param rS - radiusSearch for consider nerighbors to compute surface normal.
@@ -166,14 +197,34 @@ public:
     /**
      * @brief updateCloud - Updates the displayed cloud with the received one.
      * @param cloud_in - Input cloud to be displayed
+     * @param seq - Sequence number of the cloud (envelope count of the message it came in), or -1 if not received from a port.
+     */
+    void updateCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, int seq = -1);
+
+    /**
+     * @brief drawBatch - Applies a list of drawing commands in order, and displays the result on the next update cycle.
+     * Commands: (clear), (accum 0/1), (cloud (cloud bottle) [id version]), (update id version [(color (r g b))] [(pose (4x4 row-major))]),
+     * (sphere (x y z) (r g b)), (arrow (x0 y0 z0) (x1 y1 z1) (r g b)).
+     * Clouds sent with an id are kept, and 'update' displays that version again, recolored and/or transformed, without resending its points.
+     * @param batch - list of drawing commands
+     * @param seq - Sequence number of the batch (envelope count of the message it came in), or -1 if not received from a port.
+     */
+    void drawBatch(const yarp::os::Bottle &batch, int seq = -1);
+
+    /**
+     * @brief isDrawn - Checks whether the message with the given sequence number (or a later one) has been received on a port,
+     * and all the requested updates have been displayed.
+     * @param seq - Sequence number of the batch or cloud
+     * @param batch - true for the batches of draw:i, false for the clouds of clouds:i
      */
-    void updateCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in);
+    bool isDrawn(int seq, bool batch = true);
 
     /**
      * @brief filter - Function to apply and show different filtering processes to the displayed cloud.
+     * Parameters of each filter are set on the 'pipe_vis' group of the configuration (defaults shown).
      * @param ror - bool: Activates RadiusOutlierRemoval (rad = 0.05, minNeigh = 5).
-     * @param sor - bool: Activates StatisticalOutlierRemoval (meanK = 20).
-     * @param mls - bool: Activates MovingLeastSquares (rad = 0.02, order 2, usRad = 0.005, usStep = 0.003).
+     * @param sor - bool: Activates StatisticalOutlierRemoval (meanK = 10, stdMul = 3.0).
+     * @param mls - bool: Activates MovingLeastSquares (rad = 0.02, usRad = 0.005, usStep = 0.003, second order fit).
      * @param ds - bool: Activates Voxel Grid Downsampling (rad = 0.002).
      * @return true/false on showing the poitnclouddar =
      */
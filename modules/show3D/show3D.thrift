@@ -101,6 +101,27 @@ service show3D_IDLServer
       */
      bool saveIm(1: string name);
 
+    /**
+     * @brief drawBatch - Applies a list of drawing commands in order, on a single display update. The same batches can be sent
+     * one-way (no reply) to the /draw:i port, whose envelope count can then be waited for with sync.
+     * Commands: (clear), (accum 0/1), (cloud (cloud bottle) [id version]), (update id version [(color (r g b))] [(pose (4x4 row-major))]),
+     * (sphere (x y z) (r g b)), (arrow (x0 y0 z0) (x1 y1 z1) (r g b)).
+     * Clouds sent with an id and version are kept, so that 'update' can display them recolored and/or transformed without resending the points.
+     * @param batch - list of drawing commands
+     * @return true/false on success/failure of queueing the commands
+     */
+     bool drawBatch(1: Bottle batch);
+
+    /**
+     * @brief sync - Waits until the batch or cloud sent with the given sequence number (envelope count), and all the commands received before, are displayed.
+     * Batches on /draw:i and clouds on /clouds:i are numbered separately, by their own senders.
+     * @param seq - sequence number of the batch or cloud
+     * @param timeout - maximum time to wait, in seconds (0 to wait indefinitely)
+     * @param port - "draw" to wait for a batch of /draw:i (default), "clouds" to wait for a cloud of /clouds:i
+     * @return true when displayed, false on timeout or unknown port.
+     */
+     bool sync(1: i32 seq, 2: double timeout = 2.0, 3: string port = "draw");
+
 
     /**
      * @brief setVerbose (ON/OFF) - sets verbose of the output on or off
@@ -22,6 +22,56 @@ using namespace std;
 using namespace yarp::os;
 using namespace iCub::YarpCloud;
 
+/************************************************************************/
+//                          CLOUD RECEIVER
+/************************************************************************/
+CloudReceiver::CloudReceiver()
+{
+    visThrd = NULL;
+    cloud = pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
+}
+
+void CloudReceiver::onRead(Bottle &cloudBottle)
+{
+    if (visThrd == NULL)
+        return;
+
+    // The envelope count identifies the cloud, so that senders can wait for it to be displayed
+    Stamp stamp;
+    int seq = -1;
+    if (getEnvelope(stamp) && stamp.isValid())
+        seq = stamp.getCount();
+
+    cout<< "Received Cloud Bottle of size " << cloudBottle.size() << endl;
+    cloud->points.clear();
+    cloud->clear();
+    CloudUtils::bottle2cloud(cloudBottle,cloud);
+    cout<< "Cloud of size: " << cloud->points.size() << endl;
+    visThrd->updateCloud(cloud, seq);
+}
+
+/************************************************************************/
+//                          DRAW RECEIVER
+/************************************************************************/
+DrawReceiver::DrawReceiver()
+{
+    visThrd = NULL;
+}
+
+void DrawReceiver::onRead(Bottle &batch)
+{
+    if (visThrd == NULL)
+        return;
+
+    // As for clouds, the envelope count lets the sender wait for the batch to be displayed
+    Stamp stamp;
+    int seq = -1;
+    if (getEnvelope(stamp) && stamp.isValid())
+        seq = stamp.getCount();
+
+    visThrd->drawBatch(batch, seq);
+}
+
 /************************************************************************/
 //                          PUBLIC METHODS
 /************************************************************************/
@@ -107,6 +157,31 @@ bool ShowModule::saveIm(const string& name)
     return true;
 }
 
+bool ShowModule::drawBatch(const Bottle &batch)
+{
+    visThrd->drawBatch(batch);
+    return true;
+}
+
+bool ShowModule::sync(int seq, double timeout, const std::string &port)
+{
+    // Wait until the batch (or cloud) 'seq' and everything requested before this call is on display.
+    // Each port has its own numbering, as given by its sender.
+    bool batch = (port != "clouds");
+    if (batch && (port != "draw")){
+        cout << "Unknown port " << port << " to sync on, it can only be draw or clouds." << endl;
+        return false;
+    }
+    double t0 = Time::now();
+    while (!visThrd->isDrawn(seq, batch))
+    {
+        if ((timeout > 0.0) && (Time::now() - t0 > timeout))
+            return false;
+        Time::delay(0.005);
+    }
+    return true;
+}
+
 bool ShowModule::quit()
 {
     std::cout << "Quitting!" << std::endl;
@@ -143,6 +218,7 @@ bool ShowModule::configure(yarp::os::ResourceFinder &rf)
         attach(handlerPort);
 
     cloudsInPort.open("/"+name+"/clouds:i");
+    drawInPort.open("/"+name+"/draw:i");
 
     // Module rpc parameters
     closing = false;
@@ -150,10 +226,9 @@ bool ShowModule::configure(yarp::os::ResourceFinder &rf)
     // Init variables
     cloudfile = "cloud.ply";
 
-    cloud = pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
-
     //Threads
     visThrd = new VisThread(50, "Cloud");
+    visThrd->configureFilter(rf);
     if (!visThrd->start())
     {
         delete visThrd;
@@ -162,6 +237,13 @@ bool ShowModule::configure(yarp::os::ResourceFinder &rf)
         return false;
     }
     cout << "PCL visualizer Thread istantiated...\n";
+
+    // Clouds are displayed as soon as they are received
+    cloudsInPort.setVisualizer(visThrd);
+    cloudsInPort.useCallback();
+    drawInPort.setVisualizer(visThrd);
+    drawInPort.useCallback();
+
     cout << endl << "Configuring done."<<endl;
 
     printf("Base path: %s \n \n",cloudpath.c_str());
@@ -176,17 +258,7 @@ double ShowModule::getPeriod()
 
 bool ShowModule::updateModule()
 {
-    // read the cloud as bottle
-    Bottle *cloudBottle=cloudsInPort.read(false);
-    if (cloudBottle!=NULL){
-        cout<< "Received Cloud Bottle of size " << cloudBottle->size() << endl;
-        cloud->points.clear();
-        cloud->clear();
-        CloudUtils::bottle2cloud(*cloudBottle,cloud);
-        cout<< "Cloud of size: " << cloud->points.size() << endl;
-        visThrd->updateCloud(cloud);
-
-    }
+    // Clouds are received on the port callback
     return !closing;
 }
 
@@ -195,6 +267,7 @@ bool ShowModule::interruptModule()
     closing = true;
     handlerPort.interrupt();
     cloudsInPort.interrupt();
+    drawInPort.interrupt();
     cout<<"Interrupting your module, for port cleanup"<<endl;
     return true;
 }
@@ -204,6 +277,7 @@ bool ShowModule::close()
 {
     cout<<"Calling close function\n";
     cloudsInPort.close();
+    drawInPort.close();
     handlerPort.close();
 
     if (visThrd)
@@ -237,7 +311,7 @@ int main(int argc, char * argv[])
     ShowModule module;
     ResourceFinder rf;
     rf.setDefaultContext("toolIncorporation");
-    rf.setDefaultConfigFile("cloudsPath.ini");
+    rf.setDefaultConfigFile("show3D.ini");
     rf.setVerbose(true);
     rf.configure(argc, argv);
 
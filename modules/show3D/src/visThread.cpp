@@ -2,6 +2,7 @@
 
 using namespace std;
 using namespace yarp::os;
+using namespace iCub::YarpCloud;
 
 // Empty constructor
 VisThread::VisThread(int period, const string &_cloudname):RateThread(period), id(_cloudname){}
@@ -29,8 +30,6 @@ bool VisThread::threadInit()
     displayNormals = false;
     displayOMSEGI = false;    
     displayFilt = false;
-    displaySphere = false;
-    displayArrow = false;
     getIm = false;
 
     normalsComputed = false;
@@ -45,7 +44,12 @@ bool VisThread::threadInit()
     dFsor = false;
     dFmls = false;
     dFds = false;
+    sphereNum = 0;
     arrowNum = 0;
+    cloudSeq = -1;
+    drawnCloudSeq = -1;
+    batchSeq = -1;
+    drawnBatchSeq = -1;
 
     return true;
 }
@@ -61,7 +65,15 @@ void VisThread::run()
             // Get lock on the boolean update and check if cloud was updated
             boost::mutex::scoped_lock updateLock(updateModelMutex);
             if(update)
-            {                
+            {
+                // Clear display (before anything else, so that what was requested after clearing is kept)
+                if (clearing){
+                    viewer->removePointCloud(id);
+                    viewer->removePointCloud("normals");
+                    viewer->removeAllShapes();
+                    clearing = false;
+                }
+
                 if(updatingCloud)
                 {
                     plotNewCloud();
@@ -75,19 +87,15 @@ void VisThread::run()
                     displayBB = false;
                 }
 
-                // Dislpay sphere
-                if (displaySphere)
-                {
-                    plotSphere(sphCoords,sphColor);
-                    displaySphere = false;
-                }
+                // Dislpay spheres
+                for (size_t i = 0; i < spheres.size(); i++)
+                    plotSphere(spheres[i].coordsIni, spheres[i].color);
+                spheres.clear();
 
-                // Dislpay arrow
-                if (displayArrow)
-                {
-                    plotArrow(arrowCoordsIni, arrowCoordsEnd,arrowColor);
-                    displayArrow = false;
-                }
+                // Dislpay arrows
+                for (size_t i = 0; i < arrows.size(); i++)
+                    plotArrow(arrows[i].coordsIni, arrows[i].coordsEnd, arrows[i].color);
+                arrows.clear();
 
                 // Compute and add normals to display
                 if (displayNormals)
@@ -116,19 +124,9 @@ void VisThread::run()
                     getIm = false;
                 }
 
-                // Clear display
-                
-                if (clearing){
-                    viewer->removePointCloud(id);
-                    viewer->removePointCloud("normals");
-                    viewer->removeAllShapes();
-                    clearing = false;
-                    normalsComputed = false;
-                    cloud->clear();
-                    cloud_normals->clear();
-                }
-
                 update = false;
+                drawnCloudSeq = cloudSeq;
+                drawnBatchSeq = batchSeq;
             }
             updateLock.unlock();
         }else{
@@ -161,14 +159,130 @@ void VisThread::updateVis()
 // Clear display
 void VisThread::clearVisualizer()
 {
+    // Clear the data right away, so that clouds received before the next update cycle are not lost.
+    boost::mutex::scoped_lock updateLock(updateModelMutex);
+    clearData();
+    updateLock.unlock();
+}
+
+// Clear displayed data (with the lock held)
+void VisThread::clearData()
+{
+    cloud->clear();
+    cloud_normals->clear();
+    normalsComputed = false;
+    updatingCloud = false;
+    spheres.clear();
+    arrows.clear();
     clearing = true;
-    updateVis();
+    update = true;
+}
+
+// Apply a batch of drawing commands, in the order received, on a single update cycle
+void VisThread::drawBatch(const Bottle &batch, int seq)
+{
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in (new pcl::PointCloud<pcl::PointXYZRGB>);
+
+    boost::mutex::scoped_lock updateLock(updateModelMutex);
+    for (int i = 0; i < batch.size(); i++)
+    {
+        Bottle *cmd = batch.get(i).asList();
+        if ((cmd == NULL) || (cmd->size() < 1))
+            continue;
+        string name = cmd->get(0).asString();
+
+        if (name == "clear"){
+            clearData();
+        }else if (name == "accum"){
+            addClouds = cmd->get(1).asBool();
+        }else if ((name == "cloud") && cmd->get(1).isList()){
+            cloud_in->clear();
+            CloudUtils::bottle2cloud(*cmd->get(1).asList(), cloud_in);
+            if (cmd->size() > 3){
+                CachedCloud &cached = cachedClouds[cmd->get(2).asString()];
+                cached.cloud = pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB> (*cloud_in));
+                cached.version = cmd->get(3).asInt();
+            }
+            setCloud(cloud_in);
+        }else if ((name == "update") && (cmd->size() > 2)){
+            string cloudId = cmd->get(1).asString();
+            map<string, CachedCloud>::iterator cached = cachedClouds.find(cloudId);
+            if ((cached == cachedClouds.end()) || (cached->second.version != cmd->get(2).asInt())){
+                cout << "Version " << cmd->get(2).asInt() << " of cloud " << cloudId << " was not received, update ignored." << endl;
+                continue;
+            }
+
+            Bottle *bPose = cmd->find("pose").asList();
+            if ((bPose != NULL) && (bPose->size() == 16)){
+                Eigen::Matrix4f pose;
+                for (int r = 0; r < 4; r++)
+                    for (int c = 0; c < 4; c++)
+                        pose(r,c) = bPose->get(4*r + c).asDouble();
+                pcl::transformPointCloud(*cached->second.cloud, *cloud_in, pose);
+            }else{
+                *cloud_in = *cached->second.cloud;
+            }
+
+            Bottle *bColor = cmd->find("color").asList();
+            if ((bColor != NULL) && (bColor->size() == 3)){
+                int color[3] = {bColor->get(0).asInt(), bColor->get(1).asInt(), bColor->get(2).asInt()};
+                CloudUtils::changeCloudColor(cloud_in, color);
+            }
+            setCloud(cloud_in);
+        }else if ((name == "sphere") && cmd->get(1).isList() && cmd->get(2).isList()){
+            Bottle *bCoords = cmd->get(1).asList();
+            Bottle *bColor = cmd->get(2).asList();
+            Shape sphere;
+            for (int c = 0; c < 3; c++){
+                sphere.coordsIni.push_back(bCoords->get(c).asDouble());
+                sphere.color[c] = bColor->get(c).asInt();
+            }
+            spheres.push_back(sphere);
+        }else if ((name == "arrow") && cmd->get(1).isList() && cmd->get(2).isList() && cmd->get(3).isList()){
+            Bottle *bCoordsIni = cmd->get(1).asList();
+            Bottle *bCoordsEnd = cmd->get(2).asList();
+            Bottle *bColor = cmd->get(3).asList();
+            Shape arrow;
+            for (int c = 0; c < 3; c++){
+                arrow.coordsIni.push_back(bCoordsIni->get(c).asDouble());
+                arrow.coordsEnd.push_back(bCoordsEnd->get(c).asDouble());
+                arrow.color[c] = bColor->get(c).asInt();
+            }
+            arrows.push_back(arrow);
+        }else{
+            cout << "Unknown drawing command: " << cmd->toString() << endl;
+        }
+    }
+
+    if (seq >= 0)
+        batchSeq = seq;
+    update = true;
+    updateLock.unlock();
+}
+
+// Check whether a batch or a cloud has been displayed
+bool VisThread::isDrawn(int seq, bool batch)
+{
+    boost::mutex::scoped_lock updateLock(updateModelMutex);
+    int drawnSeq = batch ? drawnBatchSeq : drawnCloudSeq;
+    return (drawnSeq >= seq) && (!update);
 }
 
 // Display new cloud received
-void VisThread::updateCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in)
+void VisThread::updateCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, int seq)
 {
     printf("Updating displayed cloud\n");
+    boost::mutex::scoped_lock updateLock(updateModelMutex);
+    setCloud(cloud_in);
+    if (seq >= 0)
+        cloudSeq = seq;
+    updateLock.unlock();
+    printf("Cloud updated\n");
+}
+
+// Set the cloud to display (with the lock held)
+void VisThread::setCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in)
+{
     if (addClouds){
         *cloud += *cloud_in; // new cloud is added to last one
         cout << "Received cloud of size: " << cloud_in->points.size() << endl;
@@ -201,8 +315,7 @@ void VisThread::updateCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_i
     }
 
     updatingCloud = true;
-    updateVis();
-    printf("Cloud updated\n");
+    update = true;
 }
 
 
@@ -236,6 +349,14 @@ void VisThread::plotNewCloud()
 }
 
 
+// Filtering configuration
+void VisThread::configureFilter(const yarp::os::Searchable &rf)
+{
+    filterPipe.configure(rf, "pipe_vis", "(stages (ror sor mls ds)) (ror (radius 0.05) (minNeigh 5)) (sor (meanK 10) (stdMul 3.0)) "
+                                         "(mls (radius 0.02) (usRad 0.005) (usStep 0.003) (order 2)) (ds (res 0.002))");
+    cout << "Filtering stages: " << filterPipe.toString() << endl;
+}
+
 // Normal computation interface
 void VisThread::addNormals(double rS, bool normAsRGB)
 {
@@ -547,11 +668,14 @@ void VisThread::plotBB(int typeBB)
 // addSphere interface
 void VisThread::addSphere(const std::vector<double> &coords, const std::vector<int> &color )
 {
+    Shape sphere;
+    sphere.coordsIni = coords;
+    sphere.color[0] = color[0]; sphere.color[1] = color[1]; sphere.color[2] = color[2];
 
-    displaySphere = true;
-    sphColor[0] = color[0]; sphColor[1] = color[1]; sphColor[2] = color[2];
-    sphCoords = coords;
-    updateVis();
+    boost::mutex::scoped_lock updateLock(updateModelMutex);
+    spheres.push_back(sphere);
+    update = true;
+    updateLock.unlock();
 
     cout << "Sphere added" << endl;
     return;
@@ -566,8 +690,11 @@ void VisThread::plotSphere(const std::vector<double> &coords, const int color[])
     center.z = coords[2];
     double rad = 0.005;
 
+    stringstream s;
+    s << "sphere" << sphereNum;
+    sphereNum++;
 
-    viewer->addSphere(center,rad,color[0], color[1], color[2]);
+    viewer->addSphere(center,rad,color[0], color[1], color[2], s.str());
     return;
 }
 
@@ -575,12 +702,15 @@ void VisThread::plotSphere(const std::vector<double> &coords, const int color[])
 // addArrow interface
 void VisThread::addArrow(const std::vector<double> &coordsIni,const std::vector<double> &coordsEnd, const std::vector<int> &color )
 {
+    Shape arrow;
+    arrow.coordsIni = coordsIni;
+    arrow.coordsEnd = coordsEnd;
+    arrow.color[0] = color[0]; arrow.color[1] = color[1]; arrow.color[2] = color[2];
 
-    displayArrow = true;
-    arrowColor[0] = color[0]; arrowColor[1] = color[1]; arrowColor[2] = color[2];
-    arrowCoordsIni = coordsIni;
-    arrowCoordsEnd = coordsEnd;
-    updateVis();
+    boost::mutex::scoped_lock updateLock(updateModelMutex);
+    arrows.push_back(arrow);
+    update = true;
+    updateLock.unlock();
 
     cout << "Arrow added" << endl;
     return;
@@ -637,72 +767,16 @@ void VisThread::filter(bool ror, bool sor , bool mls, bool ds)
 // Computes and display Bounding Box
 void VisThread::filterCloud(bool rorF, bool sorF , bool mlsF, bool dsF)
 {
-
-    if (rorF)
-    {
-        pcl::RadiusOutlierRemoval<pcl::PointXYZRGB> ror; // -- by neighbours within radius
-        ror.setInputCloud(cloud);
-        ror.setRadiusSearch(0.05);
-        ror.setMinNeighborsInRadius(5);
-        ror.filter(*cloud);
-        cout << "--Size after rad out rem: " << cloud->points.size() << "." << endl;
-    }
-
-    if (sorF)
-    {
-        pcl::StatisticalOutlierRemoval<pcl::PointXYZRGB> sor; // -- by statistical values
-        sor.setStddevMulThresh(3.0);
-        sor.setInputCloud(cloud);
-        sor.setMeanK(10);
-        sor.filter(*cloud);
-        cout << "--Size after Stat outrem: " << cloud->points.size() << "." << endl;
-    }
-
-    if (mlsF)                                                // -- use moving least squares
-    {
-        pcl::PointCloud<pcl::PointXYZ>::Ptr cloudNoColor(new pcl::PointCloud<pcl::PointXYZ>);
-        pcl::PointCloud<pcl::PointXYZ>::Ptr cloudNoColorFilter(new pcl::PointCloud<pcl::PointXYZ>);
-        copyPointCloud(*cloud, *cloudNoColor);
-
-        //pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZRGB>);
-        //pcl::MovingLeastSquares<pcl::PointXYZRGB, pcl::PointXYZRGB> mls;
-        pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
-        pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ> mls;
-        //    mls.setInputCloud (cloud_filter);
-        mls.setInputCloud(cloudNoColor);
-        mls.setSearchMethod(tree);
-        mls.setSearchRadius(0.02);
-        mls.setPolynomialFit(true);
-        mls.setPolynomialOrder(2);
-        mls.setUpsamplingMethod(pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ>::SAMPLE_LOCAL_PLANE);
-        mls.setUpsamplingRadius(0.005);
-        mls.setUpsamplingStepSize(0.003);
-        mls.process(*cloudNoColorFilter);
-        copyPointCloud(*cloudNoColorFilter, *cloud);
-        //    mls.process (*cloud_filter);
-        cout << "--Size after Mov leastsq: " << cloud->points.size() << "." << endl;
-
-    }
-
-    if (dsF)                                                    // --Apply downsampling
-    {
-        //if (verbose){cout << "Model total points: " << cloud->size () << endl;}
-        cout << "== Size before downsampling: " << cloud->size () << endl;
-
-        pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_fil(new pcl::PointCloud<pcl::PointXYZRGB>);
-        pcl::VoxelGrid<pcl::PointXYZRGB> vg;
-        vg.setInputCloud (cloud);
-        vg.setLeafSize (0.002, 0.002, 0.002);
-        vg.filter (*cloud_fil);
-        cloud->points.clear();
-        cloud->clear();
-        copyPointCloud(*cloud_fil, *cloud);
-
-
-        //if (verbose){cout << " Downsampled to: " << cloud_ds->size () << endl;}
-        cout << "== Size after  downsampling: " << cloud->size () << endl;
-    }
-
+    // Run only the selected stages of the filtering pipeline
+    filterPipe.setStageEnabled("ror", rorF);
+    filterPipe.setStageEnabled("sor", sorF);
+    filterPipe.setStageEnabled("mls", mlsF);
+    filterPipe.setStageEnabled("ds", dsF);
+
+    cout << "== Size before filtering: " << cloud->size () << endl;
+    filterPipe.process(cloud);
+    filterPipe.printStats();
+    cout << "== Size after filtering: " << cloud->size () << endl;
 
     viewer->removePointCloud(id);
     pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> color(cloud);
@@ -0,0 +1,217 @@
+/*
+ * 3D DESCRIPTOR BENCHMARK
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+// Measures, on the machine it runs on, the extraction time and the size of every toolFeatExt descriptor for every tool model
+// found under the sample clouds folder (and its subfolders), so that descriptors can be chosen by cost as well as by accuracy.
+// Usage:
+//   descBenchmark [--clouds_path <folder>] [--descriptors "(omsegi occupancy vfh)"] [--maxDepth 2] [--binsPerDim 2] [--reps 5]
+// Normals are computed once per model and shared by all descriptors, as in toolFeatExt, so their time is reported apart.
+// The time of a descriptor includes the bounding box and the voxels of the points, which each extraction computes again.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <dirent.h>
+
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Os.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include "iCub/YarpCloud/CloudUtils.h"
+
+#include "descriptor3D.h"
+
+using namespace std;
+using namespace yarp::os;
+using namespace iCub::YarpCloud;
+
+// Totals of a descriptor over all models
+struct DescriptorStats
+{
+    string  name;
+    string  params;
+    double  time;       // ms, summed over models
+    double  values;     // summed over models
+    int     models;
+};
+
+// Appends the .pcd and .ply files under folder (relative to base) to files, in subfolders too.
+static void findClouds(const string &base, const string &folder, vector<string> &files)
+{
+    DIR *dir = opendir((base + folder).c_str());
+    if (dir == NULL)
+        return;
+
+    vector<string> subfolders;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        string name = entry->d_name;
+        if ((name == ".") || (name == ".."))
+            continue;
+
+        string::size_type idx = name.rfind('.');
+        string ext = (idx != string::npos) ? name.substr(idx + 1) : "";
+        if ((ext == "pcd") || (ext == "ply")){
+            files.push_back(folder + name);
+        }else if (idx == string::npos){
+            DIR *sub = opendir((base + folder + name).c_str());
+            if (sub != NULL){
+                closedir(sub);
+                subfolders.push_back(folder + name + "/");
+            }
+        }
+    }
+    closedir(dir);
+
+    for (size_t s = 0; s < subfolders.size(); ++s)
+        findClouds(base, subfolders[s], files);
+}
+
+int main(int argc, char * argv[])
+{
+    ResourceFinder rf;
+    rf.setVerbose(false);
+    rf.configure(argc, argv);
+
+    string cloudpath;
+    if (rf.check("clouds_path")){
+        cloudpath = rf.find("clouds_path").asString().c_str();
+    }else{
+        string icubContribEnvPath = yarp::os::getenv("ICUBcontrib_DIR");
+        cloudpath = icubContribEnvPath + "/share/ICUBcontrib/contexts/toolIncorporation/sampleClouds/";
+    }
+    if (cloudpath[cloudpath.size() - 1] != '/')
+        cloudpath += "/";
+
+    int maxDepth = rf.check("maxDepth",Value(2)).asInt();
+    int binsPerDim = rf.check("binsPerDim",Value(2)).asInt();
+    int reps = max(rf.check("reps",Value(5)).asInt(), 1);
+
+    vector<string> names;
+    if (rf.check("descriptors") && rf.find("descriptors").isList()){
+        Bottle *list = rf.find("descriptors").asList();
+        for (int d = 0; d < list->size(); ++d)
+            names.push_back(list->get(d).asString().c_str());
+    }else{
+        names = Descriptor3D::getNames();
+    }
+
+    // One instance of each descriptor, reused for all models as in toolFeatExt
+    vector<Descriptor3D*> descriptors;
+    vector<DescriptorStats> stats;
+    for (size_t d = 0; d < names.size(); ++d)
+    {
+        Descriptor3D *descriptor = Descriptor3D::create(names[d], maxDepth, binsPerDim);
+        if (descriptor == NULL){
+            cout << "Skipping descriptor " << names[d] << "." << endl;
+            continue;
+        }
+        descriptors.push_back(descriptor);
+        DescriptorStats s;
+        s.name = descriptor->getName();
+        s.params = descriptor->getParams();
+        s.time = 0.0;
+        s.values = 0.0;
+        s.models = 0;
+        stats.push_back(s);
+    }
+
+    vector<string> files;
+    findClouds(cloudpath, "", files);
+    sort(files.begin(), files.end());
+    if (files.empty() || descriptors.empty()){
+        cout << "No clouds found in " << cloudpath << " or no valid descriptors." << endl;
+        return 1;
+    }
+    cout << "Benchmarking " << descriptors.size() << " descriptors on " << files.size() << " models from " << cloudpath
+         << " (" << reps << " repetitions)." << endl;
+
+    vector<string> rows;
+    for (size_t f = 0; f < files.size(); ++f)
+    {
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZRGB>);
+        pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
+        if (!CloudUtils::loadCloud(cloudpath, files[f], cloud) || cloud->empty()){
+            cout << "Couldn't load model " << files[f] << endl;
+            continue;
+        }
+
+        double t0 = Time::now();
+        DescriptorInput::estimateNormals(cloud, *normals);
+        double normalsTime = (Time::now() - t0)*1000.0;
+
+        char row[256];
+        snprintf(row, sizeof(row), "%-32s %8d %12.2f", files[f].c_str(), (int)cloud->size(), normalsTime);
+        rows.push_back(row);
+
+        for (size_t d = 0; d < descriptors.size(); ++d)
+        {
+            vector<vector<double> > feats;
+            int used = 0;
+            t0 = Time::now();
+            for (int r = 0; r < reps; ++r){
+                DescriptorInput input(cloud, normals);
+                used = descriptors[d]->compute(input, feats);
+            }
+            double time = (Time::now() - t0)*1000.0/reps;
+
+            int values = 0;
+            int nonZero = 0;
+            for (size_t h = 0; h < feats.size(); ++h){
+                values += feats[h].size();
+                for (size_t b = 0; b < feats[h].size(); ++b)
+                    if (feats[h][b] != 0.0)
+                        nonZero++;
+            }
+
+            snprintf(row, sizeof(row), "    %-20s %12.2f %10d %10d %12d %8d", stats[d].params.c_str(), time, values, nonZero, values*(int)sizeof(float), used);
+            rows.push_back(row);
+
+            if (used >= 0){
+                stats[d].time += time;
+                stats[d].values += values;
+                stats[d].models++;
+            }
+        }
+    }
+
+    // Per model results, and averages of every descriptor over all models
+    printf("\n%-32s %8s %12s\n", "model", "points", "normals(ms)");
+    printf("    %-20s %12s %10s %10s %12s %8s\n", "descriptor", "time(ms)", "values", "non-zero", "bytes(f32)", "used");
+    for (size_t r = 0; r < rows.size(); ++r)
+        printf("%s\n", rows[r].c_str());
+
+    printf("\n%-24s %8s %14s %14s\n", "descriptor", "models", "mean time(ms)", "mean values");
+    for (size_t d = 0; d < stats.size(); ++d)
+    {
+        int n = max(stats[d].models, 1);
+        printf("%-24s %8d %14.2f %14.0f\n", stats[d].params.c_str(), stats[d].models, stats[d].time/n, stats[d].values/n);
+    }
+
+    for (size_t d = 0; d < descriptors.size(); ++d)
+        delete descriptors[d];
+    return 0;
+}
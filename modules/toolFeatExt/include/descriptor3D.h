@@ -0,0 +1,159 @@
+/*
+ * 3D DESCRIPTOR INTERFACE and the input shared by all descriptors
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __DESCRIPTOR3D_H__
+#define __DESCRIPTOR3D_H__
+
+// Includes
+#include <string>
+#include <vector>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+/**
+ * @brief The DescriptorInput class holds what all descriptors are computed from: the cloud of the tool, its normals and
+ * the cubic bounding box of its usable part. The voxel of each point is computed the first time a descriptor asks for it,
+ * and reused by the following ones for the same depth.
+ */
+class DescriptorInput
+{
+protected:
+    pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr     cloud;
+    pcl::PointCloud<pcl::Normal>::ConstPtr          normals;
+    Eigen::Vector3f                                 bbMin;
+    float                                           bbSize;
+
+    std::vector<unsigned int>                       leafCodes;      // Morton code of the voxel of each point at leafDepth
+    int                                             leafDepth;      // -1 if not computed yet
+    int                                             outOfBox;
+
+public:
+    static const unsigned int                       outside = 0xffffffff;  // code of the points out of the box
+
+    // CONSTRUCTOR
+    DescriptorInput(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &_cloud, const pcl::PointCloud<pcl::Normal>::ConstPtr &_normals);
+
+    const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& getCloud() const { return cloud; }
+    const pcl::PointCloud<pcl::Normal>::ConstPtr& getNormals() const { return normals; }
+    const Eigen::Vector3f& getBBMin() const { return bbMin; }
+    float getBBSize() const { return bbSize; }
+
+    /**
+     * @brief getLeafCodes - Returns the Morton code of the voxel of each point when the box is split in 2^depth voxels per side,
+     * or outside for the points out of the box.
+     */
+    const std::vector<unsigned int>& getLeafCodes(const int depth);
+
+    /**
+     * @brief getOutOfBox - Returns the number of points out of the bounding box.
+     */
+    int getOutOfBox();
+
+    /**
+     * @brief toolBoundingBox - Returns the cubic box that encloses the usable part of the tool: the AABB of the cloud and the
+     * hand origin, cut at the bottom of the hand (Y = 0), enlarged to a cube 1 cm larger than its largest side.
+     */
+    static void toolBoundingBox(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, Eigen::Vector3f &bbMin, float &bbSize);
+
+    /**
+     * @brief estimateNormals - Computes the normals of a cloud from all the neighbors in a sphere of radius 5 cm.
+     */
+    static void estimateNormals(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, pcl::PointCloud<pcl::Normal> &normals);
+
+    /**
+     * @brief mortonCode - Interleaves the bits of the voxel indices (x on the lowest bit of each triplet).
+     */
+    static unsigned int mortonCode(const unsigned int x, const unsigned int y, const unsigned int z);
+
+    /**
+     * @brief mortonDecode - Returns the voxel indices of a Morton code.
+     */
+    static void mortonDecode(const unsigned int code, unsigned int &x, unsigned int &y, unsigned int &z);
+
+    /**
+     * @brief halfBoxVoxels - Returns the number of voxels on the lower half (in Y) of the box, added up over depths 1 to maxDepth.
+     */
+    static size_t halfBoxVoxels(const int maxDepth);
+};
+
+/**
+ * @brief The Descriptor3D class is the interface of the 3D descriptors of the tools. Features are given as a list of vectors,
+ * whose layout depends on the descriptor.
+ * Descriptors are created by name with create(), and keep their buffers across computations, so each thread should have its own.
+ */
+class Descriptor3D
+{
+public:
+    static const size_t                             maxOutputValues = 1 << 22;  // largest feature vector accepted (32 MB of doubles)
+
+    virtual ~Descriptor3D() {}
+
+    /**
+     * @brief getName - Returns the name the descriptor is created with.
+     */
+    virtual std::string getName() const = 0;
+
+    /**
+     * @brief setParams - Sets the octree depth and the number of histogram bins per normal component, for the descriptors that use them.
+     * @return false if they are out of the range of the descriptor, or the features would have more than maxOutputValues values.
+     */
+    virtual bool setParams(const int maxDepth, const int binsPerDim) = 0;
+
+    /**
+     * @brief getParams - Returns the name and the parameters that the features depend on, e.g. to tell them apart in a cache.
+     */
+    virtual std::string getParams() const = 0;
+
+    /**
+     * @brief getBinsPerDim - Returns the number of bins per normal component if the features are a list of binsPerDim^3 histograms
+     * (the layout of the compact message), 0 otherwise.
+     */
+    virtual int getBinsPerDim() const { return 0; }
+
+    /**
+     * @brief compute - Computes the features of the input.
+     * @return number of points used, -1 on error.
+     */
+    virtual int compute(DescriptorInput &input, std::vector<std::vector<double> > &feats) = 0;
+
+    /**
+     * @brief printStats - Prints details of the last computation.
+     */
+    virtual void printStats() const {}
+
+    /**
+     * @brief create - Returns a new descriptor (omsegi, occupancy or vfh), to be deleted by the caller, or NULL if the name
+     * or the parameters are not valid.
+     */
+    static Descriptor3D* create(const std::string &name, const int maxDepth = 2, const int binsPerDim = 2, const bool sparse = false);
+
+    /**
+     * @brief getNames - Returns the names of all available descriptors.
+     */
+    static std::vector<std::string> getNames();
+
+    /**
+     * @brief checkParams - Returns true if every descriptor accepts the depth and number of bins, so that they stay valid
+     * when the descriptor is changed. Otherwise prints why the first one rejecting them does so.
+     */
+    static bool checkParams(const int maxDepth, const int binsPerDim);
+};
+
+#endif
+
@@ -0,0 +1,89 @@
+/*
+ * PARALLEL OMS-EGI EXTRACTION of a tool model at many poses
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __FEATBATCH_H__
+#define __FEATBATCH_H__
+
+// Includes
+#include <string>
+#include <vector>
+
+#include <yarp/os/Mutex.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include "descriptor3D.h"
+
+/**
+ * @brief The FeatBatch class computes the features of one tool model at a list of poses, distributing the poses
+ * among a set of worker threads. Each worker has its own descriptor, and transforms its own copy of the model and normals,
+ * so the model is only read.
+ * Results are stored by pose index, so their order does not depend on the scheduling.
+ */
+class FeatBatch
+{
+public:
+    struct Job {
+        Eigen::Matrix<float,4,4,Eigen::DontAlign>   pose;   // transformation from the canonical model
+        std::vector<std::vector<double> >           feats;  // output features
+        bool                                        ok;
+    };
+
+protected:
+    std::string                                     descriptor;
+    int                                             maxDepth;
+    int                                             binsPerDim;
+    bool                                            sparse;
+
+    // State of the running batch, shared with the workers
+    pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr     cloudModel;
+    pcl::PointCloud<pcl::Normal>::ConstPtr          normalsModel;
+    std::vector<Job>                                *jobs;
+    size_t                                          nextJob;
+    yarp::os::Mutex                                 mutex;
+
+    class Worker;
+    bool takeJob(size_t &index);
+    void processJob(Job &job, Descriptor3D &engine,
+                    pcl::PointCloud<pcl::PointXYZRGB>::Ptr &cloudPose, pcl::PointCloud<pcl::Normal>::Ptr &normalsPose);
+
+public:
+    // CONSTRUCTOR
+    FeatBatch(const std::string &_descriptor = "omsegi", int _maxDepth = 2, int _binsPerDim = 2, bool _sparse = false);
+
+    /**
+     * @brief run - Computes the features of the model at the pose of every job, and blocks until all are done.
+     * @param cloud - Tool model in its canonical pose.
+     * @param normals - Normals of the model.
+     * @param jobsIn - Poses to process. Their feats and ok are filled in.
+     * @param numThreads - Number of worker threads.
+     * @return true if the features of all jobs were computed.
+     */
+    bool run(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, const pcl::PointCloud<pcl::Normal>::ConstPtr &normals,
+             std::vector<Job> &jobsIn, const int numThreads);
+
+    /**
+     * @brief transformNormals - Rotates the normals of a cloud by the rotation part of the transformation TM.
+     */
+    static void transformNormals(const pcl::PointCloud<pcl::Normal> &normalsIn, const Eigen::Matrix4f &TM,
+                                 pcl::PointCloud<pcl::Normal> &normalsOut);
+};
+
+#endif
+
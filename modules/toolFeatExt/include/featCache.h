@@ -0,0 +1,108 @@
+/*
+ * FEATURE CACHE keyed by model, pose and descriptor parameters
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __FEATCACHE_H__
+#define __FEATCACHE_H__
+
+// Includes
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <stdint.h>
+
+#include <yarp/os/Mutex.h>
+#include <yarp/sig/Matrix.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+/**
+ * @brief The FeatCache class keeps the last computed feature vectors in memory, evicting the least recently used ones,
+ * and optionally in a directory on disk, so that they survive restarts of the module.
+ * Entries are identified by a key made of the content hash of the model, its pose quantized to 1 mm / 0.001,
+ * and the descriptor parameters.
+ */
+class FeatCache
+{
+public:
+    typedef std::vector<std::vector<double> > Feats;
+
+protected:
+    typedef std::list<std::pair<std::string, Feats> > EntryList;
+
+    size_t                                          capacity;
+    std::string                                     dir;            // empty to keep entries in memory only
+    EntryList                                       entries;        // most recently used first
+    std::map<std::string, EntryList::iterator>      index;
+    int                                             hits;
+    int                                             misses;
+    yarp::os::Mutex                                 mutex;
+
+    void insert(const std::string &key, const Feats &feats);
+    std::string filePath(const std::string &key);
+    bool load(const std::string &key, Feats &feats);
+    bool save(const std::string &key, const Feats &feats);
+
+public:
+    // CONSTRUCTOR
+    FeatCache(size_t _capacity = 64, const std::string &_dir = "");
+
+    /**
+     * @brief configure - Sets the number of entries kept in memory (0 disables the cache) and the directory
+     * of the disk cache (empty to disable it), creating it if needed. Entries in memory are kept.
+     */
+    bool configure(const size_t _capacity, const std::string &_dir);
+
+    /**
+     * @brief get - Looks for the features of key in memory, and then on disk.
+     * @return true if they were found.
+     */
+    bool get(const std::string &key, Feats &feats);
+
+    /**
+     * @brief put - Stores the features of key, in memory and on disk if enabled.
+     */
+    void put(const std::string &key, const Feats &feats);
+
+    /**
+     * @brief clear - Removes all entries in memory (the disk cache is kept) and resets the statistics.
+     */
+    void clear();
+
+    /**
+     * @brief getStats - Returns the number of entries in memory, hits and misses since the last clear.
+     */
+    void getStats(int &size, int &nHits, int &nMisses);
+
+    /**
+     * @brief hashCloud - Returns a 64 bit hash (FNV-1a) of the coordinates of the points of the cloud.
+     */
+    static uint64_t hashCloud(const pcl::PointCloud<pcl::PointXYZRGB> &cloud);
+
+    /**
+     * @brief makeKey - Returns the key of the features of a model at a pose.
+     * @param modelHash - Hash of the model cloud.
+     * @param pose - 4x4 transformation of the model.
+     * @param params - Descriptor name and parameters.
+     */
+    static std::string makeKey(const uint64_t modelHash, const yarp::sig::Matrix &pose, const std::string &params);
+};
+
+#endif
+
@@ -0,0 +1,53 @@
+/*
+ * COMPACT ENCODING of the OMS-EGI feature vectors
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __FEATCODEC_H__
+#define __FEATCODEC_H__
+
+#include "ToolFeat3DwithOrient.h"
+#include "ToolFeat3DCompact.h"
+
+/**
+ * @brief The FeatCodec class converts feature vectors between the list of histograms of ToolFeat3DwithOrient
+ * and the flat ToolFeat3DCompact message, where empty histograms cost one bit of the occupancy mask and the
+ * others are stored as float32 or, quantized, as uint8.
+ */
+class FeatCodec
+{
+public:
+    /**
+     * @brief pack - Encodes the features as a compact message.
+     * @param feats - Features as computed by the module (all histograms of the same size binsPerDim^3).
+     * @param maxDepth - Depth used to compute them.
+     * @param binsPerDim - Bins per dimension used to compute them.
+     * @param quantize - Store values as uint8 (round(value*255)), as histograms are normalized to [0, 1].
+     * @param compact - Encoded message.
+     * @return false if a histogram does not have binsPerDim^3 values.
+     */
+    static bool pack(const ToolFeat3DwithOrient &feats, const int maxDepth, const int binsPerDim, const bool quantize,
+                     ToolFeat3DCompact &compact);
+
+    /**
+     * @brief unpack - Decodes a compact message back into the list of histograms, with empty histograms filled with 0s.
+     * @return false if the message is inconsistent with its dimensions.
+     */
+    static bool unpack(const ToolFeat3DCompact &compact, ToolFeat3DwithOrient &feats);
+};
+
+#endif
+
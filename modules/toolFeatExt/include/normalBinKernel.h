@@ -0,0 +1,53 @@
+/*
+ * NORMAL HISTOGRAM KERNEL shared by the 3D descriptors
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __NORMALBINKERNEL_H__
+#define __NORMALBINKERNEL_H__
+
+// Includes
+#include <vector>
+
+#include <pcl/point_types.h>
+
+/**
+ * @brief The NormalBinKernel class assigns normals to the bins of the EGI histogram: each normal component in [-1, 1]
+ * is split in binsPerDim bins, and the bin index is (xbin*binsPerDim + ybin)*binsPerDim + zbin.
+ * With SSE2, 4 normals are processed at once. binsPerDim 2, 3 and 4 have their own compiled versions, other values
+ * use a generic one.
+ */
+class NormalBinKernel
+{
+public:
+    /**
+     * @brief computeBins - Computes the histogram bin of each normal.
+     * @param normals - Array of n normals.
+     * @param n - Number of normals.
+     * @param binsPerDim - Number of bins per normal component.
+     * @param bins - Output array of n bin indices, -1 for normals with non-finite components.
+     * @return number of normals with a valid bin.
+     */
+    static int computeBins(const pcl::Normal *normals, const size_t n, const int binsPerDim, int *bins);
+
+    /**
+     * @brief accumulate - Adds the count of each bin to hist (of size binsPerDim^3), skipping invalid (-1) bins.
+     */
+    static void accumulate(const int *bins, const size_t n, std::vector<float> &hist);
+};
+
+#endif
+
@@ -0,0 +1,64 @@
+/*
+ * VOXEL OCCUPANCY DESCRIPTOR
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __OCCUPANCYDESCRIPTOR_H__
+#define __OCCUPANCYDESCRIPTOR_H__
+
+// Includes
+#include <vector>
+
+#include "descriptor3D.h"
+
+/**
+ * @brief The OccupancyDescriptor class describes the shape of the tool by the fraction of its points that falls in each voxel of
+ * the bounding box split in 2^d voxels per side, for every depth d from 1 to maxDepth. It uses the same voxels as OMS-EGI,
+ * but no normals, so it is a cheaper and shorter alternative.
+ */
+class OccupancyDescriptor : public Descriptor3D
+{
+protected:
+    int                                 maxDepth;
+    std::vector<unsigned int>           voxels;                 // x, y and z leaf voxel indices of each point in the box
+
+    static const int                    maxDepthLimit = 10;     // Morton codes of 3x10 bits
+
+public:
+    // CONSTRUCTOR
+    OccupancyDescriptor(int _maxDepth = 2);
+
+    std::string getName() const { return "occupancy"; }
+    std::string getParams() const;
+
+    /**
+     * @brief setParams - Sets the octree depth. The number of bins is not used.
+     * @return false if the depth is out of [1, 10] or the features would exceed maxOutputValues (depth 8 or more).
+     */
+    bool setParams(const int _maxDepth, const int binsPerDim);
+
+    /**
+     * @brief compute - Computes the descriptor.
+     * @param input - Cloud and bounding box.
+     * @param feats - One vector per depth, with the fraction of the points in the box that fall in each voxel on the lower
+     * half (in Y) of the box, ordered by x, y and z voxel index.
+     * @return number of points in the box.
+     */
+    int compute(DescriptorInput &input, std::vector<std::vector<double> > &feats);
+};
+
+#endif
+
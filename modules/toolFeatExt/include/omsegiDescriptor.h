@@ -0,0 +1,110 @@
+/*
+ * OMS-EGI DESCRIPTOR computed over all octree depths in a single pass
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __OMSEGIDESCRIPTOR_H__
+#define __OMSEGIDESCRIPTOR_H__
+
+// Includes
+#include <vector>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include "descriptor3D.h"
+
+/**
+ * @brief The OMSEGIDescriptor class computes the Oriented Multi-Scale Extended Gaussian Image of a cloud:
+ * the normal histogram of the whole cloud, followed by the normal histograms of the voxels of a cubic bounding box
+ * split in 2^d voxels per side, for every depth d from 1 to maxDepth.
+ * Each point is assigned once the Morton code of its voxel at maxDepth. As the 8 children of a voxel have consecutive
+ * codes, the histograms of each coarser depth are obtained by adding up consecutive groups of 8 voxels of the finer one,
+ * so the cost is linear in the number of points plus the number of voxels, whatever maxDepth is.
+ * The histograms of all depths are kept in a single flat array, allocated on the heap and reused across computations.
+ * In sparse mode only the occupied voxels get a histogram while computing, which saves memory and time on high depths,
+ * but the features still hold a histogram for every voxel, so the depth and bins are limited by their size.
+ */
+class OMSEGIDescriptor : public Descriptor3D
+{
+protected:
+    int                                 maxDepth;
+    int                                 binsPerDim;
+    int                                 histSize;               // binsPerDim^3
+    bool                                sparse;                 // requested storage
+    bool                                sparseUsed;             // storage of the last computation
+
+    // Normal counts per voxel and bin of all depths, one histogram after another.
+    // Dense: every voxel of every depth, in Morton order.
+    // Sparse: occupied voxels only, sorted by Morton code, whose codes are in voxCodes.
+    std::vector<float>                  hists;
+    std::vector<size_t>                 levelStart;             // first voxel of each depth
+    std::vector<size_t>                 levelSize;              // number of voxels kept at each depth
+    std::vector<unsigned int>           voxCodes;
+    std::vector<int>                    normalBins;             // histogram bin of each normal, -1 if not valid
+    std::vector<std::pair<unsigned int, int> > samples;         // (leaf code, bin) of each point in the box
+
+    static const int                    maxDepthLimit = 10;     // Morton codes of 3x10 bits
+    static const size_t                 maxDenseCells = 1 << 24; // Above this size, dense storage switches to sparse
+
+    void accumulateDense();
+    void accumulateSparse();
+    const float* voxelHist(const int depth, const unsigned int code) const;
+
+public:
+    // CONSTRUCTOR
+    OMSEGIDescriptor(int _maxDepth = 2, int _binsPerDim = 2, bool _sparse = false);
+
+    std::string getName() const { return "omsegi"; }
+    std::string getParams() const;
+    int getBinsPerDim() const { return binsPerDim; }
+
+    /**
+     * @brief setParams - Sets the octree depth and the number of histogram bins per normal component.
+     * @return false if the depth is out of [0, 10], there are no bins, or the features (binsPerDim^3 values for the whole cloud and
+     * for each voxel on the lower half of the box at every depth) would exceed maxOutputValues (e.g. depth 7 with 2 bins).
+     */
+    bool setParams(const int _maxDepth, const int _binsPerDim);
+
+    /**
+     * @brief setSparse - Selects whether histograms are kept only for occupied voxels. The result is the same either way.
+     * Dense storage is faster for low depths, and falls back to sparse when it would exceed 2^24 values.
+     */
+    void setSparse(const bool _sparse);
+
+    /**
+     * @brief compute - Computes the descriptor. Points with non-finite normals are ignored, and points out of the bounding box
+     * only count for the whole cloud histogram.
+     * @param input - Cloud, normals and bounding box.
+     * @param feats - One histogram (binsPerDim^3 values adding up to 1, or all 0 for empty voxels) for the whole cloud, followed by
+     * those of the voxels on the lower half (in Y) of the box at each depth, ordered by x, y and z voxel index.
+     * @return number of points with a valid normal.
+     */
+    int compute(DescriptorInput &input, std::vector<std::vector<double> > &feats);
+
+    /**
+     * @brief printStats - Prints the number of occupied voxels at each depth on the last computation.
+     */
+    void printStats() const;
+
+    /**
+     * @brief getOccupiedCount - Returns the number of voxels with valid normals at the given depth on the last computation.
+     */
+    int getOccupiedCount(const int depth) const;
+};
+
+#endif
+
@@ -22,12 +22,14 @@
 #include <iostream>
 #include <math.h>
 #include <vector>
+#include <fstream>
 #include <ctime>
 
 // YARP - iCub libs
 #include <yarp/os/all.h>
 #include <yarp/sig/all.h>
 #include <yarp/math/Rand.h>
+#include <yarp/math/RandScalar.h>
 #include <yarp/math/Math.h>
 #include <yarp/os/Time.h>
 
@@ -53,15 +55,65 @@
 
 //for the thrift interface
 #include "ToolFeat3DwithOrient.h"
+#include "ToolFeat3DCompact.h"
 #include "VoxFeat.h"
 #include "Point3D.h"
 
+#include "descriptor3D.h"
+#include "featBatch.h"
+#include "featCodec.h"
+#include "featCache.h"
+
 #include <tool3DFeat_IDLServer.h>
 
 /**********************************************************
     PUBLIC METHODS
 /**********************************************************/
 
+/**********************************************************/
+class CloudReceiver : public yarp::os::BufferedPort<yarp::os::Bottle>
+{   // Port that converts the received clouds as soon as they arrive, and keeps the latest one until the module takes it.
+protected:
+    yarp::os::Mutex mutex;
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr latest;  // Last cloud received, NULL once taken
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr expected;// Cloud received with the expected sequence number, NULL until then
+    int seq;                                        // Sequence number of the last cloud received
+    int expectedSeq;                                // Sequence number waited for, -1 if none
+
+public:
+    CloudReceiver();
+    virtual void onRead(yarp::os::Bottle &cloudBottle);
+
+    /**
+     * @brief take - Hands over the last cloud received, if it has not been taken yet.
+     * @param cloud_out - the received cloud, which the receiver does not modify afterwards.
+     * @param seq_out - its sequence number (envelope count of the message it came in).
+     * @return true if there was a cloud to take.
+     */
+    bool take(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &cloud_out, int &seq_out);
+
+    /**
+     * @brief discard - Drops the last cloud received, if not taken yet, when the module replaces it with a model.
+     */
+    void discard();
+
+    /**
+     * @brief expect - Starts waiting for the cloud with the given sequence number. A cloud already received with that number,
+     * and not taken yet, counts as received. Clouds with other numbers are ignored, so that a stale count from a previous sender,
+     * or the counts of other senders, cannot be taken for it.
+     * @param seq_in - sequence number (envelope count) of the cloud to wait for, -1 to stop waiting.
+     */
+    void expect(const int seq_in);
+
+    /**
+     * @brief takeExpected - Hands over the cloud set with expect(), once received. Any cloud received besides it is dropped,
+     * so that it remains the one used until a new cloud arrives.
+     * @param cloud_out - the expected cloud.
+     * @return true if it has been received.
+     */
+    bool takeExpected(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &cloud_out);
+};
+
 /**********************************************************/
 class ToolFeatExt : public yarp::os::RFModule, public tool3DFeat_IDLServer
 {
@@ -74,7 +126,7 @@ protected:
 
     yarp::os::Port      feat3DoutPort; // Port where the features of the tool are send out (as a thrift Tool3DwithOrient struct)    
     yarp::os::BufferedPort<yarp::os::Bottle> cloudsOutPort; // Port to send out the cloud as a boltte to be further processed or displayed
-    yarp::os::BufferedPort<yarp::os::Bottle> cloudsInPort; // Port to send out the cloud as a boltte to be further processed or displayed
+    CloudReceiver       cloudsInPort; // Port to receive clouds, handled on arrival
     std::string cloudpath;            // path to folder with .ply or .pcd files
     std::string cloudname;           // name of the .ply or .pcd cloud file
 
@@ -83,23 +135,40 @@ protected:
     /* class variables */
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig; // Point cloud
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;      // Point cloud of the transformed model
+    pcl::PointCloud<pcl::Normal>::Ptr      normals_orig; // Normals of the model, computed once when it is loaded
+    pcl::PointCloud<pcl::Normal>::Ptr      normals;     // Normals of the transformed model
     yarp::sig::Matrix                      rotMat;     // Rotation Matrix specifying grasp pose
 
     bool verbose;
     int maxDepth;
     int binsPerDim;
+    bool sparseHist;
+    std::string featsFormat;            // list, compact or compact8 (quantized)
+    FeatCache featCache;                // features already computed
+    uint64_t modelHash;                 // content hash of cloud_orig
+    uint64_t cloudHash;                 // cloud is the model with this hash ...
+    yarp::sig::Matrix cloudPose;        // ... at this pose
+    std::string descName;               // name of the descriptor ...
+    Descriptor3D *descriptor;           // ... used to extract the features
 
     std::vector<yarp::os::Bottle>   models;             // Vector to contain all models considered in the experiment.
 
     bool closing;
     bool cloudLoaded;
     bool cloudTransformed;
+    bool normalsReady;                      // normals correspond to cloud
 
     /* functions*/    
+    std::string modelFile(const std::string &tool);
     bool loadToolModel(const std::string &tool);
     bool loadModelsFromFile(yarp::os::ResourceFinder &rf);
+    bool takeReceivedCloud();
+    void useReceivedCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr received, const int seq);
     bool transform2pose(const yarp::sig::Matrix& toolPose = yarp::math::eye(4,4));
-    int  computeOMSEGI();
+    int  computeFeats();
+    std::string descriptorParams();
+    yarp::sig::Matrix canonicalPose(const double deg, const int disp = 0);
+    bool computeNormals(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::Normal>::Ptr normals_out);
     bool sendCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in);
     std::string deg2ori(const float deg);
 
@@ -107,8 +176,10 @@ public:
 
     // RPC Accesible methods
     bool                        getFeats();
+    std::vector<ToolFeat3DwithOrient> getFeatsBatch(const std::vector<yarp::sig::Matrix>& poses, const int threads = 4);
     bool                        getAllToolFeats(const int n_samples, bool pics);
     bool                        getSamples(const int n, const double deg);
+    bool                        buildDataset(const std::string& file, const int n_samples = 1, const int threads = 4);
     bool                        setPose(const yarp::sig::Matrix& rotMat);
     bool                        setCanonicalPose(const double deg = 0.0, const int disp = 0);
 
@@ -116,6 +187,10 @@ public:
     bool                        setDepth(const int depthN = 2);
     bool                        loadModel(const std::string& name = "cloud.ply");
     bool                        setName(const std::string& name = "cloud.ply");
+    bool                        waitCloud(const int seq, const double timeout = 2.0);
+    bool                        setDescriptor(const std::string& name = "omsegi");
+    bool                        setFeatsFormat(const std::string& format);
+    bool                        clearCache();
     bool                        setVerbose(const std::string& verb);
 
     // module control //
@@ -0,0 +1,67 @@
+/*
+ * GLOBAL VIEWPOINT FEATURE HISTOGRAM DESCRIPTOR
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __VFHDESCRIPTOR_H__
+#define __VFHDESCRIPTOR_H__
+
+// Includes
+#include <vector>
+
+#include <pcl/features/vfh.h>
+#include <pcl/search/kdtree.h>
+
+#include "descriptor3D.h"
+
+/**
+ * @brief The VFHDescriptor class describes the whole tool with a single Viewpoint Feature Histogram (PCL VFHEstimation):
+ * the distribution of the angles between the normals of its points and its centroid, plus that of the normals wrt the
+ * direction from the hand origin, which makes it orientation dependent. It does not depend on the octree depth nor on
+ * the number of bins, and its cost is linear in the number of points.
+ */
+class VFHDescriptor : public Descriptor3D
+{
+protected:
+    pcl::VFHEstimation<pcl::PointXYZRGB, pcl::Normal, pcl::VFHSignature308>     vfh;
+    pcl::search::KdTree<pcl::PointXYZRGB>::Ptr                                  tree;
+    pcl::PointCloud<pcl::VFHSignature308>                                       signature;
+
+public:
+    static const int                    histSize = 308;
+
+    // CONSTRUCTOR
+    VFHDescriptor();
+
+    std::string getName() const { return "vfh"; }
+    std::string getParams() const { return "vfh"; }
+
+    /**
+     * @brief setParams - The VFH has no parameters, so any depth and number of bins are accepted.
+     */
+    bool setParams(const int maxDepth, const int binsPerDim) { return true; }
+
+    /**
+     * @brief compute - Computes the descriptor.
+     * @param input - Cloud and normals. Points with non-finite normals are ignored.
+     * @param feats - A single histogram of 308 values adding up to 1 (all 0 if there are no valid normals).
+     * @return number of points with a valid normal.
+     */
+    int compute(DescriptorInput &input, std::vector<std::vector<double> > &feats);
+};
+
+#endif
+
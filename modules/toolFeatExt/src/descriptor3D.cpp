@@ -0,0 +1,192 @@
+#include "descriptor3D.h"
+#include "omsegiDescriptor.h"
+#include "occupancyDescriptor.h"
+#include "vfhDescriptor.h"
+
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+
+#include <pcl/features/normal_3d.h>
+#include <pcl/search/kdtree.h>
+
+using namespace std;
+
+/************************************************************************/
+//                          DESCRIPTOR INPUT
+/************************************************************************/
+DescriptorInput::DescriptorInput(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &_cloud, const pcl::PointCloud<pcl::Normal>::ConstPtr &_normals):
+    cloud(_cloud), normals(_normals), leafDepth(-1), outOfBox(0)
+{
+    toolBoundingBox(*cloud, bbMin, bbSize);
+}
+
+const vector<unsigned int>& DescriptorInput::getLeafCodes(const int depth)
+{
+    if (depth == leafDepth)
+        return leafCodes;
+
+    const int leavesPerSide = 1 << depth;
+    const float leafSize = bbSize/leavesPerSide;
+
+    leafCodes.resize(cloud->size());
+    outOfBox = 0;
+    for (size_t p = 0; p < cloud->size(); ++p)
+    {
+        const pcl::PointXYZRGB &point = cloud->points[p];
+        int vx = (int)floor((point.x - bbMin.x())/leafSize);
+        int vy = (int)floor((point.y - bbMin.y())/leafSize);
+        int vz = (int)floor((point.z - bbMin.z())/leafSize);
+        if ((vx < 0) || (vy < 0) || (vz < 0) || (vx >= leavesPerSide) || (vy >= leavesPerSide) || (vz >= leavesPerSide)){
+            leafCodes[p] = outside;
+            outOfBox++;
+        }else{
+            leafCodes[p] = mortonCode(vx, vy, vz);
+        }
+    }
+    leafDepth = depth;
+    return leafCodes;
+}
+
+int DescriptorInput::getOutOfBox()
+{
+    if (leafDepth < 0)
+        getLeafCodes(0);
+    return outOfBox;
+}
+
+void DescriptorInput::toolBoundingBox(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, Eigen::Vector3f &bbMin, float &bbSize)
+{
+    // AABB, including the hand origin
+    Eigen::Vector3f minAABB(0.0f, 0.0f, 0.0f);
+    Eigen::Vector3f maxAABB(0.0f, 0.0f, 0.0f);
+    for (size_t p = 0; p < cloud.points.size(); ++p)
+    {
+        const pcl::PointXYZRGB &point = cloud.points[p];
+        minAABB.x() = min(minAABB.x(), point.x);
+        minAABB.y() = min(minAABB.y(), point.y);
+        minAABB.z() = min(minAABB.z(), point.z);
+        maxAABB.x() = max(maxAABB.x(), point.x);
+        maxAABB.y() = max(maxAABB.y(), point.y);
+        maxAABB.z() = max(maxAABB.z(), point.z);
+    }
+    maxAABB.y() = 0.0f; // Limit the bounding box to the bottom of the hand, so only the "usable" part of the tool gets represented.
+
+    // Cubic bounding box centered on the AABB, 1 cm larger than its largest side
+    // (the box the octree used to build from the AABB with a resolution of half that size).
+    bbSize = (maxAABB - minAABB).maxCoeff() + 0.01f;
+    bbMin = (minAABB + maxAABB - Eigen::Vector3f::Constant(bbSize))/2.0f;
+}
+
+void DescriptorInput::estimateNormals(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, pcl::PointCloud<pcl::Normal> &normals)
+{
+    // Normal estimation class, and pass the input dataset to it
+    pcl::NormalEstimation<pcl::PointXYZRGB, pcl::Normal> ne;
+
+    // Create an empty kdtree representation, and pass it to the normal estimation object.
+    // Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
+    pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZRGB> ());
+    ne.setSearchMethod (tree);
+
+    // Clear output cloud
+    normals.points.clear();
+
+    // Pass the input cloud to the normal estimation class
+    ne.setInputCloud (cloud);
+
+    // Use all neighbors in a sphere of radius 5 cm
+    ne.setRadiusSearch (0.05);
+
+    // Compute the normals
+    ne.compute (normals);
+}
+
+// Spread the lower 10 bits of v so that there are 2 zeros between each of them
+static unsigned int spreadBits(unsigned int v)
+{
+    v &= 0x000003ff;
+    v = (v | (v << 16)) & 0xff0000ff;
+    v = (v | (v << 8))  & 0x0300f00f;
+    v = (v | (v << 4))  & 0x030c30c3;
+    v = (v | (v << 2))  & 0x09249249;
+    return v;
+}
+
+// Inverse of spreadBits: gather every third bit into the lower 10 bits
+static unsigned int compactBits(unsigned int v)
+{
+    v &= 0x09249249;
+    v = (v | (v >> 2))  & 0x030c30c3;
+    v = (v | (v >> 4))  & 0x0300f00f;
+    v = (v | (v >> 8))  & 0xff0000ff;
+    v = (v | (v >> 16)) & 0x000003ff;
+    return v;
+}
+
+unsigned int DescriptorInput::mortonCode(const unsigned int x, const unsigned int y, const unsigned int z)
+{
+    return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+}
+
+void DescriptorInput::mortonDecode(const unsigned int code, unsigned int &x, unsigned int &y, unsigned int &z)
+{
+    x = compactBits(code);
+    y = compactBits(code >> 1);
+    z = compactBits(code >> 2);
+}
+
+size_t DescriptorInput::halfBoxVoxels(const int maxDepth)
+{
+    size_t numVox = 0;
+    for (int depth = 1; depth <= maxDepth; ++depth)
+        numVox += ((size_t)1 << (3*depth))/2;
+    return numVox;
+}
+
+/************************************************************************/
+//                          DESCRIPTOR FACTORY
+/************************************************************************/
+Descriptor3D* Descriptor3D::create(const string &name, const int maxDepth, const int binsPerDim, const bool sparse)
+{
+    // Created with default parameters, and then validated once
+    Descriptor3D *descriptor = NULL;
+    if (name == "omsegi")
+        descriptor = new OMSEGIDescriptor(2, 2, sparse);
+    else if (name == "occupancy")
+        descriptor = new OccupancyDescriptor();
+    else if (name == "vfh")
+        descriptor = new VFHDescriptor();
+    else{
+        cout << "Unknown descriptor " << name << ", it can only be omsegi, occupancy or vfh." << endl;
+        return NULL;
+    }
+
+    if (!descriptor->setParams(maxDepth, binsPerDim)){
+        delete descriptor;
+        return NULL;
+    }
+    return descriptor;
+}
+
+vector<string> Descriptor3D::getNames()
+{
+    vector<string> names;
+    names.push_back("omsegi");
+    names.push_back("occupancy");
+    names.push_back("vfh");
+    return names;
+}
+
+bool Descriptor3D::checkParams(const int maxDepth, const int binsPerDim)
+{
+    vector<string> names = getNames();
+    for (size_t i = 0; i < names.size(); ++i){
+        Descriptor3D *descriptor = create(names[i], maxDepth, binsPerDim);
+        if (descriptor == NULL){
+            cout << "Depth " << maxDepth << " and " << binsPerDim << " bins are not valid for the " << names[i] << " descriptor." << endl;
+            return false;
+        }
+        delete descriptor;
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+#include "featBatch.h"
+
+#include <algorithm>
+
+#include <yarp/os/Thread.h>
+#include <pcl/common/transforms.h>
+
+using namespace std;
+using namespace yarp::os;
+
+// Worker thread: takes jobs until there are none left, with its own descriptor and cloud buffers
+class FeatBatch::Worker : public Thread
+{
+    FeatBatch                                   &batch;
+    Descriptor3D                                *engine;
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr      cloudPose;
+    pcl::PointCloud<pcl::Normal>::Ptr           normalsPose;
+
+public:
+    Worker(FeatBatch &_batch):
+        batch(_batch), engine(Descriptor3D::create(_batch.descriptor, _batch.maxDepth, _batch.binsPerDim, _batch.sparse)),
+        cloudPose(new pcl::PointCloud<pcl::PointXYZRGB>), normalsPose(new pcl::PointCloud<pcl::Normal>) {}
+
+    ~Worker() { delete engine; }
+
+    bool isValid() const { return engine != NULL; }
+
+    virtual void run()
+    {
+        size_t index;
+        while (!isStopping() && batch.takeJob(index))
+            batch.processJob((*batch.jobs)[index], *engine, cloudPose, normalsPose);
+    }
+};
+
+// Constructor
+FeatBatch::FeatBatch(const string &_descriptor, int _maxDepth, int _binsPerDim, bool _sparse):
+    descriptor(_descriptor), maxDepth(_maxDepth), binsPerDim(_binsPerDim), sparse(_sparse), jobs(NULL), nextJob(0) {}
+
+bool FeatBatch::takeJob(size_t &index)
+{
+    mutex.lock();
+    bool ok = nextJob < jobs->size();
+    if (ok)
+        index = nextJob++;
+    mutex.unlock();
+    return ok;
+}
+
+void FeatBatch::processJob(Job &job, Descriptor3D &engine,
+                           pcl::PointCloud<pcl::PointXYZRGB>::Ptr &cloudPose, pcl::PointCloud<pcl::Normal>::Ptr &normalsPose)
+{
+    Eigen::Matrix4f TM = job.pose;
+    pcl::transformPointCloud(*cloudModel, *cloudPose, TM);
+    transformNormals(*normalsModel, TM, *normalsPose);
+
+    DescriptorInput input(cloudPose, normalsPose);
+    job.ok = engine.compute(input, job.feats) >= 0;
+}
+
+bool FeatBatch::run(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr &cloud, const pcl::PointCloud<pcl::Normal>::ConstPtr &normals,
+                    vector<Job> &jobsIn, const int numThreads)
+{
+    if (jobsIn.empty())
+        return true;
+
+    cloudModel = cloud;
+    normalsModel = normals;
+    jobs = &jobsIn;
+    nextJob = 0;
+    for (size_t j = 0; j < jobsIn.size(); ++j)
+        jobsIn[j].ok = false;
+
+    int numWorkers = max(1, min(numThreads, (int)jobsIn.size()));
+    vector<Worker*> workers;
+    for (int w = 0; w < numWorkers; ++w){
+        workers.push_back(new Worker(*this));
+        if (!workers.back()->isValid()){
+            delete workers.back();
+            workers.pop_back();
+            break;
+        }
+        workers.back()->start();
+    }
+    for (size_t w = 0; w < workers.size(); ++w){
+        workers[w]->join();
+        delete workers[w];
+    }
+
+    jobs = NULL;
+    cloudModel.reset();
+    normalsModel.reset();
+
+    bool ok = true;
+    for (size_t j = 0; j < jobsIn.size(); ++j)
+        ok = ok && jobsIn[j].ok;
+    return ok;
+}
+
+void FeatBatch::transformNormals(const pcl::PointCloud<pcl::Normal> &normalsIn, const Eigen::Matrix4f &TM,
+                                 pcl::PointCloud<pcl::Normal> &normalsOut)
+{
+    // Normals of a rigidly transformed cloud are the rotated normals of the original one
+    Eigen::Matrix3f R = TM.block<3,3>(0,0);
+    normalsOut = normalsIn;
+    for (size_t i = 0; i < normalsOut.points.size(); ++i)
+        normalsOut.points[i].getNormalVector3fMap() = R * normalsIn.points[i].getNormalVector3fMap();
+}
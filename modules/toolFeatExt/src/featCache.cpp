@@ -0,0 +1,218 @@
+#include "featCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <math.h>
+
+#include <yarp/os/Os.h>
+
+using namespace std;
+using namespace yarp::os;
+using namespace yarp::sig;
+
+// FNV-1a, 64 bit
+static const uint64_t fnvOffset = 14695981039346656037ULL;
+static const uint64_t fnvPrime = 1099511628211ULL;
+
+static uint64_t fnvAdd(uint64_t hash, const void *data, const size_t size)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i){
+        hash ^= bytes[i];
+        hash *= fnvPrime;
+    }
+    return hash;
+}
+
+// Constructor
+FeatCache::FeatCache(size_t _capacity, const string &_dir):
+    capacity(_capacity), dir(_dir), hits(0), misses(0) {}
+
+bool FeatCache::configure(const size_t _capacity, const string &_dir)
+{
+    mutex.lock();
+    capacity = _capacity;
+    dir = _dir;
+    while (entries.size() > capacity){
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    mutex.unlock();
+
+    if (!dir.empty() && (yarp::os::mkdir_p(dir.c_str()) != 0)){
+        cout << "Could not create feature cache directory " << dir << endl;
+        return false;
+    }
+    return true;
+}
+
+bool FeatCache::get(const string &key, Feats &feats)
+{
+    mutex.lock();
+    map<string, EntryList::iterator>::iterator it = index.find(key);
+    if (it != index.end()){
+        // Move to the front, as most recently used
+        entries.splice(entries.begin(), entries, it->second);
+        feats = it->second->second;
+        hits++;
+        mutex.unlock();
+        return true;
+    }
+    mutex.unlock();
+
+    bool found = load(key, feats);
+
+    mutex.lock();
+    if (found){
+        insert(key, feats);
+        hits++;
+    }else{
+        misses++;
+    }
+    mutex.unlock();
+    return found;
+}
+
+void FeatCache::put(const string &key, const Feats &feats)
+{
+    mutex.lock();
+    insert(key, feats);
+    mutex.unlock();
+    save(key, feats);
+}
+
+// Adds or refreshes an entry in memory, called with the mutex locked
+void FeatCache::insert(const string &key, const Feats &feats)
+{
+    if (capacity == 0)
+        return;
+
+    map<string, EntryList::iterator>::iterator it = index.find(key);
+    if (it != index.end()){
+        it->second->second = feats;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    entries.push_front(make_pair(key, feats));
+    index[key] = entries.begin();
+    while (entries.size() > capacity){
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void FeatCache::clear()
+{
+    mutex.lock();
+    entries.clear();
+    index.clear();
+    hits = 0;
+    misses = 0;
+    mutex.unlock();
+}
+
+void FeatCache::getStats(int &size, int &nHits, int &nMisses)
+{
+    mutex.lock();
+    size = entries.size();
+    nHits = hits;
+    nMisses = misses;
+    mutex.unlock();
+}
+
+// Disk entries are named after the hash of the key, and store the key to tell collisions apart.
+// The size of every vector is stored with it; the extension changed with that, so entries of the older format are not read.
+string FeatCache::filePath(const string &key)
+{
+    uint64_t hash = fnvAdd(fnvOffset, key.c_str(), key.size());
+    ostringstream path;
+    path << dir << "/" << hex << setw(16) << setfill('0') << hash << ".feats";
+    return path.str();
+}
+
+bool FeatCache::load(const string &key, Feats &feats)
+{
+    if (dir.empty())
+        return false;
+
+    ifstream in(filePath(key).c_str(), ios::in | ios::binary);
+    if (!in.is_open())
+        return false;
+
+    int keySize, numHists, histSize;
+    in.read((char*)&keySize, sizeof(int));
+    if (!in || (keySize != (int)key.size()))
+        return false;
+    string storedKey(keySize, '\0');
+    in.read(&storedKey[0], keySize);
+    if (!in || (storedKey != key))
+        return false;
+
+    in.read((char*)&numHists, sizeof(int));
+    if (!in || (numHists < 0))
+        return false;
+
+    feats.assign(numHists, vector<double>());
+    for (int h = 0; h < numHists; ++h){
+        in.read((char*)&histSize, sizeof(int));
+        if (!in || (histSize < 0))
+            return false;
+        feats[h].resize(histSize);
+        if (histSize > 0)
+            in.read((char*)&feats[h][0], histSize*sizeof(double));
+    }
+    return !in.fail();
+}
+
+bool FeatCache::save(const string &key, const Feats &feats)
+{
+    if (dir.empty())
+        return false;
+
+    ofstream out(filePath(key).c_str(), ios::out | ios::binary);
+    if (!out.is_open()){
+        cout << "Could not write feature cache file " << filePath(key) << endl;
+        return false;
+    }
+
+    int keySize = key.size();
+    int numHists = feats.size();
+    out.write((const char*)&keySize, sizeof(int));
+    out.write(key.c_str(), keySize);
+    out.write((const char*)&numHists, sizeof(int));
+    for (int h = 0; h < numHists; ++h){
+        // Vectors may have different sizes (e.g. occupancy, one per depth)
+        int histSize = feats[h].size();
+        out.write((const char*)&histSize, sizeof(int));
+        if (histSize > 0)
+            out.write((const char*)&feats[h][0], histSize*sizeof(double));
+    }
+    return !out.fail();
+}
+
+uint64_t FeatCache::hashCloud(const pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+{
+    uint64_t hash = fnvOffset;
+    for (size_t p = 0; p < cloud.points.size(); ++p){
+        const pcl::PointXYZRGB &point = cloud.points[p];
+        hash = fnvAdd(hash, &point.x, sizeof(float));
+        hash = fnvAdd(hash, &point.y, sizeof(float));
+        hash = fnvAdd(hash, &point.z, sizeof(float));
+    }
+    return hash;
+}
+
+string FeatCache::makeKey(const uint64_t modelHash, const Matrix &pose, const string &params)
+{
+    ostringstream key;
+    key << hex << setw(16) << setfill('0') << modelHash << dec << "_" << params;
+
+    // Rotation and translation (m) in thousandths
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            key << "_" << (long)floor(pose(r,c)*1000.0 + 0.5);
+    return key.str();
+}
@@ -0,0 +1,101 @@
+#include "featCodec.h"
+
+#include <iostream>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+using namespace std;
+
+bool FeatCodec::pack(const ToolFeat3DwithOrient &feats, const int maxDepth, const int binsPerDim, const bool quantize,
+                     ToolFeat3DCompact &compact)
+{
+    const size_t histSize = binsPerDim*binsPerDim*binsPerDim;
+    const size_t numHists = feats.toolFeats.size();
+
+    compact.toolname = feats.toolname;
+    compact.orientation = feats.orientation;
+    compact.maxDepth = maxDepth;
+    compact.binsPerDim = binsPerDim;
+    compact.numHists = numHists;
+    compact.quantized = quantize;
+    compact.occupancy.assign((numHists + 7)/8, '\0');
+    compact.values.clear();
+    compact.values.reserve(numHists*histSize*(quantize ? 1 : 4));
+
+    for (size_t h = 0; h < numHists; ++h)
+    {
+        const vector<double> &hist = feats.toolFeats[h];
+        if (hist.size() != histSize){
+            cout << "Histogram " << h << " has " << hist.size() << " values instead of " << histSize << "." << endl;
+            return false;
+        }
+
+        bool occupied = false;
+        for (size_t b = 0; (b < histSize) && !occupied; ++b)
+            occupied = hist[b] != 0.0;
+        if (!occupied)
+            continue;
+        compact.occupancy[h/8] |= (char)(1 << (h%8));
+
+        for (size_t b = 0; b < histSize; ++b)
+        {
+            if (quantize){
+                double q = floor(hist[b]*255.0 + 0.5);
+                compact.values.push_back((char)(unsigned char)(q < 0.0 ? 0 : (q > 255.0 ? 255 : q)));
+            }else{
+                // float32, little-endian
+                float value = (float)hist[b];
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                for (int byte = 0; byte < 4; ++byte)
+                    compact.values.push_back((char)((bits >> (8*byte)) & 0xff));
+            }
+        }
+    }
+    return true;
+}
+
+bool FeatCodec::unpack(const ToolFeat3DCompact &compact, ToolFeat3DwithOrient &feats)
+{
+    const size_t histSize = compact.binsPerDim*compact.binsPerDim*compact.binsPerDim;
+    const size_t numHists = compact.numHists;
+    const size_t valueSize = compact.quantized ? 1 : 4;
+
+    if (compact.occupancy.size() != (numHists + 7)/8){
+        cout << "Occupancy mask does not match the number of histograms." << endl;
+        return false;
+    }
+
+    feats.toolname = compact.toolname;
+    feats.orientation = compact.orientation;
+    feats.toolFeats.assign(numHists, vector<double>(histSize, 0.0));
+
+    size_t pos = 0;
+    for (size_t h = 0; h < numHists; ++h)
+    {
+        if (!((unsigned char)compact.occupancy[h/8] & (1 << (h%8))))
+            continue;
+
+        if (pos + histSize*valueSize > compact.values.size()){
+            cout << "Compact features have less values than their occupancy mask requires." << endl;
+            return false;
+        }
+
+        vector<double> &hist = feats.toolFeats[h];
+        for (size_t b = 0; b < histSize; ++b)
+        {
+            if (compact.quantized){
+                hist[b] = (unsigned char)compact.values[pos++]/255.0;
+            }else{
+                uint32_t bits = 0;
+                for (int byte = 0; byte < 4; ++byte)
+                    bits |= (uint32_t)(unsigned char)compact.values[pos++] << (8*byte);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                hist[b] = value;
+            }
+        }
+    }
+    return true;
+}
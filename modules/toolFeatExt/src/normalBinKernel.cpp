@@ -0,0 +1,115 @@
+#include "normalBinKernel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Bin of a single normal. B is the number of bins per component when known at compile time, 0 to use runtimeB.
+template <int B>
+static inline int normalBin(const pcl::Normal &normal, const int runtimeB)
+{
+    const int b = (B > 0) ? B : runtimeB;
+    const float scale = 0.5f*b;
+    const float x = normal.normal_x;
+    const float y = normal.normal_y;
+    const float z = normal.normal_z;
+
+    // x - x is NaN for NaN and infinite components
+    if (!((x - x == 0.0f) && (y - y == 0.0f) && (z - z == 0.0f)))
+        return -1;
+
+    // Components equal to 1 fall on the last bin
+    int xbin = (int)((x + 1.0f)*scale);
+    int ybin = (int)((y + 1.0f)*scale);
+    int zbin = (int)((z + 1.0f)*scale);
+    xbin = (xbin < 0) ? 0 : ((xbin > b - 1) ? b - 1 : xbin);
+    ybin = (ybin < 0) ? 0 : ((ybin > b - 1) ? b - 1 : ybin);
+    zbin = (zbin < 0) ? 0 : ((zbin > b - 1) ? b - 1 : zbin);
+
+    return (xbin*b + ybin)*b + zbin;
+}
+
+#ifdef __SSE2__
+// 4 normals per iteration: their components are transposed into x, y and z vectors, binned and combined in SSE registers.
+template <int B>
+static int computeBinsImpl(const pcl::Normal *normals, const size_t n, const int runtimeB, int *bins)
+{
+    const int b = (B > 0) ? B : runtimeB;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(0.5f*b);
+    const __m128 lastBin = _mm_set1_ps((float)(b - 1));
+    const __m128 strideY = _mm_set1_ps((float)b);
+    const __m128 strideX = _mm_set1_ps((float)(b*b));
+    const __m128i invalid = _mm_set1_epi32(-1);
+
+    int valid = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(normals[i].data_n);
+        __m128 y = _mm_loadu_ps(normals[i + 1].data_n);
+        __m128 z = _mm_loadu_ps(normals[i + 2].data_n);
+        __m128 w = _mm_loadu_ps(normals[i + 3].data_n);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        __m128 finite = _mm_and_ps(_mm_and_ps(_mm_cmpeq_ps(_mm_sub_ps(x, x), zero),
+                                              _mm_cmpeq_ps(_mm_sub_ps(y, y), zero)),
+                                   _mm_cmpeq_ps(_mm_sub_ps(z, z), zero));
+
+        // Clamped bin of each component, truncated to an integer value
+        __m128 xbin = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(x, one), scale), zero), lastBin)));
+        __m128 ybin = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(y, one), scale), zero), lastBin)));
+        __m128 zbin = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(z, one), scale), zero), lastBin)));
+
+        __m128i bin = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(xbin, strideX), _mm_mul_ps(ybin, strideY)), zbin));
+        __m128i mask = _mm_castps_si128(finite);
+        bin = _mm_or_si128(_mm_and_si128(mask, bin), _mm_andnot_si128(mask, invalid));
+        _mm_storeu_si128((__m128i*)(bins + i), bin);
+
+        int m = _mm_movemask_ps(finite);
+        valid += (m & 1) + ((m >> 1) & 1) + ((m >> 2) & 1) + ((m >> 3) & 1);
+    }
+
+    for (; i < n; ++i)
+    {
+        bins[i] = normalBin<B>(normals[i], runtimeB);
+        if (bins[i] >= 0)
+            valid++;
+    }
+    return valid;
+}
+#else
+template <int B>
+static int computeBinsImpl(const pcl::Normal *normals, const size_t n, const int runtimeB, int *bins)
+{
+    int valid = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bins[i] = normalBin<B>(normals[i], runtimeB);
+        if (bins[i] >= 0)
+            valid++;
+    }
+    return valid;
+}
+#endif
+
+int NormalBinKernel::computeBins(const pcl::Normal *normals, const size_t n, const int binsPerDim, int *bins)
+{
+    switch (binsPerDim)
+    {
+    case 2:     return computeBinsImpl<2>(normals, n, binsPerDim, bins);
+    case 3:     return computeBinsImpl<3>(normals, n, binsPerDim, bins);
+    case 4:     return computeBinsImpl<4>(normals, n, binsPerDim, bins);
+    default:    return computeBinsImpl<0>(normals, n, binsPerDim, bins);
+    }
+}
+
+void NormalBinKernel::accumulate(const int *bins, const size_t n, vector<float> &hist)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (bins[i] >= 0)
+            hist[bins[i]] += 1.0f;
+}
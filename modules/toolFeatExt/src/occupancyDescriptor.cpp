@@ -0,0 +1,80 @@
+#include "occupancyDescriptor.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// Constructor
+OccupancyDescriptor::OccupancyDescriptor(int _maxDepth):
+    maxDepth(2)
+{
+    setParams(_maxDepth, 0);
+}
+
+bool OccupancyDescriptor::setParams(const int _maxDepth, const int binsPerDim)
+{
+    if ((_maxDepth < 1) || (_maxDepth > maxDepthLimit)){
+        cout << "Occupancy depth must be in [1, " << maxDepthLimit << "]." << endl;
+        return false;
+    }
+    if (DescriptorInput::halfBoxVoxels(_maxDepth) > maxOutputValues){
+        cout << "Occupancy with depth " << _maxDepth << " would have more than the " << maxOutputValues << " values allowed." << endl;
+        return false;
+    }
+    maxDepth = _maxDepth;
+    return true;
+}
+
+string OccupancyDescriptor::getParams() const
+{
+    stringstream params;
+    params << "occupancy_d" << maxDepth;
+    return params.str();
+}
+
+int OccupancyDescriptor::compute(DescriptorInput &input, vector<vector<double> > &feats)
+{
+    // Leaf voxel of each point in the box, shared with the other descriptors of the same input
+    const vector<unsigned int> &leafCodes = input.getLeafCodes(maxDepth);
+    voxels.clear();
+    for (size_t p = 0; p < leafCodes.size(); ++p)
+    {
+        if (leafCodes[p] == DescriptorInput::outside)
+            continue;
+        unsigned int x, y, z;
+        DescriptorInput::mortonDecode(leafCodes[p], x, y, z);
+        voxels.push_back(x);
+        voxels.push_back(y);
+        voxels.push_back(z);
+    }
+    const int inBox = voxels.size()/3;
+
+    // Count of each voxel at every depth: the voxel at depth d of a leaf is given by the upper d bits of its indices.
+    // Only the lower half of the box in Y is kept, to remove the handle from the feature vector.
+    feats.assign(maxDepth, vector<double>());
+    for (int d = 1; d <= maxDepth; ++d)
+    {
+        const int shift = maxDepth - d;
+        const unsigned int voxPerSide = 1 << d;
+        const unsigned int half = voxPerSide/2;
+        vector<double> &counts = feats[d - 1];
+        counts.assign(voxPerSide*half*voxPerSide, 0.0);
+        for (size_t v = 0; v < voxels.size(); v += 3)
+        {
+            unsigned int i = voxels[v] >> shift;
+            unsigned int j = voxels[v + 1] >> shift;
+            unsigned int k = voxels[v + 2] >> shift;
+            if (j < half)
+                counts[(i*half + j)*voxPerSide + k] += 1.0;
+        }
+        if (inBox > 0)
+            for (size_t c = 0; c < counts.size(); ++c)
+                counts[c] /= inBox;
+    }
+
+    if (input.getOutOfBox() > 0)
+        cout << input.getOutOfBox() << " points out of the bounding box were left out of the occupancy." << endl;
+
+    return inBox;
+}
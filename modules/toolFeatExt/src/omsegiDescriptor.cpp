@@ -0,0 +1,248 @@
+#include "omsegiDescriptor.h"
+#include "normalBinKernel.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+// Constructor
+OMSEGIDescriptor::OMSEGIDescriptor(int _maxDepth, int _binsPerDim, bool _sparse):
+    maxDepth(2), binsPerDim(2), histSize(8), sparse(_sparse), sparseUsed(_sparse)
+{
+    setParams(_maxDepth, _binsPerDim);
+}
+
+bool OMSEGIDescriptor::setParams(const int _maxDepth, const int _binsPerDim)
+{
+    if ((_maxDepth < 0) || (_maxDepth > maxDepthLimit) || (_binsPerDim < 1)){
+        cout << "OMS-EGI depth must be in [0, " << maxDepthLimit << "] and the number of bins positive." << endl;
+        return false;
+    }
+
+    // The features hold a histogram for every voxel, occupied or not, whatever the storage used to compute them
+    double numValues = (double)(1 + DescriptorInput::halfBoxVoxels(_maxDepth))*_binsPerDim*_binsPerDim*_binsPerDim;
+    if (numValues > (double)maxOutputValues){
+        cout << "OMS-EGI with depth " << _maxDepth << " and " << _binsPerDim << " bins would have " << numValues
+             << " values, more than the " << maxOutputValues << " allowed. Use a lower depth or fewer bins." << endl;
+        return false;
+    }
+    maxDepth = _maxDepth;
+    binsPerDim = _binsPerDim;
+    histSize = binsPerDim*binsPerDim*binsPerDim;
+    return true;
+}
+
+void OMSEGIDescriptor::setSparse(const bool _sparse)
+{
+    sparse = _sparse;
+}
+
+string OMSEGIDescriptor::getParams() const
+{
+    stringstream params;
+    params << "omsegi_d" << maxDepth << "_b" << binsPerDim;
+    return params.str();
+}
+
+// Histograms of every voxel at every depth, from the leaf bins in samples
+void OMSEGIDescriptor::accumulateDense()
+{
+    levelStart.resize(maxDepth + 1);
+    levelSize.resize(maxDepth + 1);
+    size_t numVox = 0;
+    for (int d = 0; d <= maxDepth; ++d){
+        levelStart[d] = numVox;
+        levelSize[d] = (size_t)1 << (3*d);
+        numVox += levelSize[d];
+    }
+    hists.assign(numVox*histSize, 0.0f);
+
+    float *leafHists = &hists[levelStart[maxDepth]*histSize];
+    for (size_t s = 0; s < samples.size(); ++s)
+        leafHists[(size_t)samples[s].first*histSize + samples[s].second] += 1.0f;
+
+    // Coarser depths: the 8 children of voxel v are voxels 8v to 8v+7 of the finer depth
+    for (int d = maxDepth - 1; d >= 0; --d)
+    {
+        const float *src = &hists[levelStart[d + 1]*histSize];
+        float *dst = &hists[levelStart[d]*histSize];
+        for (size_t v = 0; v < levelSize[d]; ++v, dst += histSize)
+            for (int c = 0; c < 8; ++c, src += histSize)
+                for (int b = 0; b < histSize; ++b)
+                    dst[b] += src[b];
+    }
+}
+
+// Histograms of the occupied voxels only, from the leaf bins in samples
+void OMSEGIDescriptor::accumulateSparse()
+{
+    levelStart.assign(maxDepth + 1, 0);
+    levelSize.assign(maxDepth + 1, 0);
+    voxCodes.clear();
+    hists.clear();
+
+    // Leaves: one histogram per distinct code
+    std::sort(samples.begin(), samples.end());
+    for (size_t s = 0; s < samples.size(); ++s)
+    {
+        if ((s == 0) || (samples[s].first != voxCodes.back())){
+            voxCodes.push_back(samples[s].first);
+            hists.resize(hists.size() + histSize, 0.0f);
+        }
+        hists[(voxCodes.size() - 1)*histSize + samples[s].second] += 1.0f;
+    }
+    levelStart[maxDepth] = 0;
+    levelSize[maxDepth] = voxCodes.size();
+
+    // Coarser depths: children are sorted, so those of the same parent (code >> 3) are consecutive
+    for (int d = maxDepth - 1; d >= 0; --d)
+    {
+        size_t fineBegin = levelStart[d + 1];
+        size_t fineEnd = fineBegin + levelSize[d + 1];
+        levelStart[d] = voxCodes.size();
+        for (size_t v = fineBegin; v < fineEnd; ++v)
+        {
+            unsigned int parent = voxCodes[v] >> 3;
+            if ((v == fineBegin) || (parent != voxCodes.back())){
+                voxCodes.push_back(parent);
+                hists.resize(hists.size() + histSize, 0.0f);
+            }
+            size_t dst = (voxCodes.size() - 1)*histSize;
+            size_t src = v*histSize;
+            for (int b = 0; b < histSize; ++b)
+                hists[dst + b] += hists[src + b];
+        }
+        levelSize[d] = voxCodes.size() - levelStart[d];
+    }
+}
+
+// Histogram of a voxel on the last computation, NULL if it is not kept
+const float* OMSEGIDescriptor::voxelHist(const int depth, const unsigned int code) const
+{
+    if (!sparseUsed)
+        return &hists[(levelStart[depth] + code)*histSize];
+
+    vector<unsigned int>::const_iterator begin = voxCodes.begin() + levelStart[depth];
+    vector<unsigned int>::const_iterator end = begin + levelSize[depth];
+    vector<unsigned int>::const_iterator it = std::lower_bound(begin, end, code);
+    if ((it == end) || (*it != code))
+        return NULL;
+    return &hists[(it - voxCodes.begin())*histSize];
+}
+
+int OMSEGIDescriptor::compute(DescriptorInput &input, vector<vector<double> > &feats)
+{
+    const pcl::PointCloud<pcl::PointXYZRGB> &cloud = *input.getCloud();
+    const pcl::PointCloud<pcl::Normal> &normals = *input.getNormals();
+
+    feats.clear();
+    if (normals.size() != cloud.size()){
+        cout << "Cloud has " << cloud.size() << " points but " << normals.size() << " normals." << endl;
+        return -1;
+    }
+
+    // Dense storage of all depths takes (8^(maxDepth+1)-1)/7 histograms
+    size_t denseCells = ((((size_t)1 << (3*(maxDepth + 1))) - 1)/7)*histSize;
+    sparseUsed = sparse || (denseCells > maxDenseCells);
+    if (sparseUsed && !sparse)
+        cout << "Histograms of depth " << maxDepth << " with " << histSize << " bins are too large to keep every voxel, keeping occupied ones only." << endl;
+
+    // Histogram bin of every normal, and whole cloud histogram
+    vector<float> cloudHist(histSize, 0.0f);
+    normalBins.resize(cloud.size());
+    int okNormals = 0;
+    if (!cloud.points.empty()){
+        okNormals = NormalBinKernel::computeBins(&normals.points[0], normals.size(), binsPerDim, &normalBins[0]);
+        NormalBinKernel::accumulate(&normalBins[0], normalBins.size(), cloudHist);
+    }
+
+    // Single pass over the points: leaf voxel of each valid normal at maxDepth
+    const vector<unsigned int> &leafCodes = input.getLeafCodes(maxDepth);
+    samples.clear();
+    int outOfBox = 0;
+    for (size_t p = 0; p < cloud.size(); ++p)
+    {
+        int bin = normalBins[p];
+        if (bin < 0)
+            continue;
+
+        if (leafCodes[p] == DescriptorInput::outside){
+            outOfBox++;
+            continue;
+        }
+
+        samples.push_back(std::make_pair(leafCodes[p], bin));
+    }
+
+    if (sparseUsed)
+        accumulateSparse();
+    else
+        accumulateDense();
+
+    // Whole cloud histogram, normalized to sum 1
+    vector<double> featVecHist(histSize, 0.0);
+    for (int b = 0; b < histSize; ++b)
+        if (okNormals)
+            featVecHist[b] = cloudHist[b]/(float)okNormals;
+    feats.push_back(featVecHist);
+
+    // Voxel histograms, normalized by the number of points in each voxel.
+    // Only the lower half of the box in Y is kept, to remove the handle from the feature vector.
+    for (int d = 1; d <= maxDepth; ++d)
+    {
+        int voxPerSide = 1 << d;
+        for (int i = 0; i < voxPerSide; ++i){
+            for (int j = 0; j < voxPerSide/2; ++j){
+                for (int k = 0; k < voxPerSide; ++k){
+                    vector<double> histVec(histSize, 0.0);
+                    const float *hist = voxelHist(d, DescriptorInput::mortonCode(i, j, k));
+                    if (hist != NULL){
+                        float voxCount = 0.0f;
+                        for (int b = 0; b < histSize; ++b)
+                            voxCount += hist[b];
+                        if (voxCount > 0.0f)
+                            for (int b = 0; b < histSize; ++b)
+                                histVec[b] = hist[b]/voxCount;
+                    }
+                    feats.push_back(histVec);
+                }
+            }
+        }
+    }
+
+    if (outOfBox > 0)
+        cout << outOfBox << " points out of the bounding box were left out of the voxel histograms." << endl;
+
+    return okNormals;
+}
+
+void OMSEGIDescriptor::printStats() const
+{
+    for (int depth = 1; depth <= maxDepth; ++depth){
+        cout << "Depth " << depth << ": " << getOccupiedCount(depth) << " of " << pow(8.0,depth) << " voxels occupied." << endl;
+    }
+}
+
+int OMSEGIDescriptor::getOccupiedCount(const int depth) const
+{
+    if ((depth < 0) || (depth >= (int)levelSize.size()))
+        return 0;
+
+    if (sparseUsed)
+        return levelSize[depth];
+
+    int occupied = 0;
+    for (size_t v = 0; v < levelSize[depth]; ++v){
+        const float *hist = &hists[(levelStart[depth] + v)*histSize];
+        for (int b = 0; b < histSize; ++b){
+            if (hist[b] > 0.0f){
+                occupied++;
+                break;
+            }
+        }
+    }
+    return occupied;
+}
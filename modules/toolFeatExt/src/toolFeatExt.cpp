@@ -24,15 +24,89 @@ using namespace yarp::sig;
 using namespace yarp::math;
 using namespace iCub::YarpCloud;
 
-// This module is mainly concerned with getting OMS-EGI 3D features from a point cloud. Therefore, it can:
+// This module is mainly concerned with getting OMS-EGI 3D features (or other descriptors, see setDescriptor) from a point cloud. Therefore, it can:
 // - load cloud from model (loadModel) and orient it with matrix (setPose-setCanonicalPose)
-// - read a cloud (on updateModule) and set it as the model.
+// - read a cloud (as soon as it arrives on clouds:i) and set it as the model.
 // - compute features on command and send them out (getFeat), and set paraemters
 // - Optionally,
 //      - compute automatically all features for all available models. (getAllToolFeats).
 //      - get multiple samples from a single tool-pose with slight variations (getSamples).
 
 
+/************************************************************************/
+//                          CLOUD RECEIVER
+/************************************************************************/
+CloudReceiver::CloudReceiver()
+{
+    seq = -1;
+    expectedSeq = -1;
+}
+
+void CloudReceiver::onRead(Bottle &cloudBottle)
+{
+    // The envelope count identifies the cloud, so that senders can wait for it to be received
+    Stamp stamp;
+    int cloudSeq = -1;
+    if (getEnvelope(stamp) && stamp.isValid())
+        cloudSeq = stamp.getCount();
+
+    // Convert into a new cloud outside the lock, and only swap the pointer in, so the module is never kept waiting by the conversion.
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr received (new pcl::PointCloud<pcl::PointXYZRGB>);
+    CloudUtils::bottle2cloud(cloudBottle,received);
+
+    mutex.lock();
+    latest = received;
+    seq = (cloudSeq >= 0) ? cloudSeq : seq + 1;
+    if ((expectedSeq >= 0) && (cloudSeq == expectedSeq))
+        expected = received;
+    mutex.unlock();
+}
+
+bool CloudReceiver::take(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &cloud_out, int &seq_out)
+{
+    mutex.lock();
+    if (!latest){
+        mutex.unlock();
+        return false;
+    }
+    cloud_out.swap(latest);
+    latest.reset();
+    seq_out = seq;
+    mutex.unlock();
+    return true;
+}
+
+void CloudReceiver::discard()
+{
+    mutex.lock();
+    latest.reset();
+    mutex.unlock();
+}
+
+void CloudReceiver::expect(const int seq_in)
+{
+    mutex.lock();
+    expectedSeq = seq_in;
+    expected.reset();
+    if ((expectedSeq >= 0) && latest && (seq == expectedSeq))
+        expected = latest;
+    mutex.unlock();
+}
+
+bool CloudReceiver::takeExpected(pcl::PointCloud<pcl::PointXYZRGB>::Ptr &cloud_out)
+{
+    mutex.lock();
+    if (!expected){
+        mutex.unlock();
+        return false;
+    }
+    cloud_out.swap(expected);
+    expected.reset();
+    expectedSeq = -1;
+    latest.reset();
+    mutex.unlock();
+    return true;
+}
 
 /************************* RF overwrites ********************************/
 /************************************************************************/
@@ -62,7 +136,23 @@ bool ToolFeatExt::configure(ResourceFinder &rf)
 
     verbose = rf.check("verbose",Value(true)).asBool();
     maxDepth = rf.check("maxDepth",Value(2)).asInt();
-    binsPerDim = rf.check("binRes",Value(2)).asInt();
+    binsPerDim = rf.check("binsPerDim",Value(rf.check("binRes",Value(2)).asInt())).asInt();
+    sparseHist = rf.check("sparseHist",Value(false)).asBool();     // keep histograms of occupied voxels only
+    descriptor = NULL;
+    if (!Descriptor3D::checkParams(maxDepth, binsPerDim)){
+        return false;
+    }
+    if (!setDescriptor(rf.check("descriptor",Value("omsegi")).asString().c_str())){
+        return false;
+    }
+    if (!setFeatsFormat(rf.check("featsFormat",Value("list")).asString().c_str())){
+        return false;
+    }
+
+    // Cache of computed features, in memory and optionally on disk
+    int cacheSize = rf.check("featCacheSize",Value(64)).asInt();
+    string cacheDir = rf.check("featCacheDir",Value("")).asString().c_str();
+    featCache.configure(max(cacheSize, 0), cacheDir);
 
     loadModelsFromFile(rf);
 
@@ -87,6 +177,9 @@ bool ToolFeatExt::configure(ResourceFinder &rf)
     }
     attach(rpcInPort);
 
+    // Clouds are converted as soon as they are received, and taken when features are requested
+    cloudsInPort.useCallback();
+
     /* Module rpc parameters */
     closing = false;
 
@@ -96,7 +189,13 @@ bool ToolFeatExt::configure(ResourceFinder &rf)
     cloudname = "cloud.ply";
     cloud_orig = pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
     cloud = pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
+    normals_orig = pcl::PointCloud<pcl::Normal>::Ptr (new pcl::PointCloud<pcl::Normal>);
+    normals = pcl::PointCloud<pcl::Normal>::Ptr (new pcl::PointCloud<pcl::Normal>);
+    normalsReady = false;
     rotMat = eye(4,4);
+    modelHash = 0;
+    cloudHash = 0;
+    cloudPose = eye(4,4);
 
     cout << endl << "Configuring done."<<endl;
 
@@ -111,18 +210,7 @@ double ToolFeatExt::getPeriod()
 
 bool ToolFeatExt::updateModule()
 {
-    // read the cloud as bottle
-    Bottle *cloudBottle=cloudsInPort.read(false);
-    if (cloudBottle!=NULL){
-        cout<< "Received Cloud Bottle of size " << cloudBottle->size() << endl;
-        cloud->points.clear();
-        cloud->clear();
-        CloudUtils::bottle2cloud(*cloudBottle,cloud);
-        cout<< "Cloud of size: " << cloud->points.size() << endl;
-        sendCloud(cloud);
-        cloudTransformed = true;
-        cloudLoaded =true;
-    }
+    // Clouds are received on the clouds:i callback
     return !closing;
 }
 
@@ -147,6 +235,8 @@ bool ToolFeatExt::close()
     cloudsInPort.close();
     feat3DoutPort.close();
     rpcVisualizerPort.close();
+    delete descriptor;
+    descriptor = NULL;
     return true;
 }
 
@@ -166,7 +256,7 @@ bool ToolFeatExt::attach(RpcServer &source)
 /**********************************************************/
 bool ToolFeatExt::getFeats()
 {   // computes 3D oriented -normalized voxel wise EGI - tool featues.
-    int ok = computeOMSEGI();
+    int ok = computeFeats();
     if (ok>=0) {        
         return true;
     } else {
@@ -176,6 +266,67 @@ bool ToolFeatExt::getFeats()
 }
 
 
+/**********************************************************/
+vector<ToolFeat3DwithOrient> ToolFeatExt::getFeatsBatch(const vector<Matrix>& poses, const int threads)
+{   // Computes the features of the loaded model at every pose in parallel, and returns them all in the reply.
+    // The model is not transformed nor republished, so getFeats and setPose are not affected.
+    vector<ToolFeat3DwithOrient> feats;
+    if (!cloudLoaded){
+        if (!loadToolModel(cloudname))
+        {
+            fprintf(stdout,"Couldn't load cloud \n");
+            return feats;
+        }
+    }
+
+    // A cloud received on clouds:i is only known at the pose it came in, so there is no model to place at other poses
+    if (cloud_orig->empty()){
+        fprintf(stdout,"No tool model loaded to compute features at many poses, load one with loadModel. \n");
+        return feats;
+    }
+
+    // Poses whose features are cached are filled in directly, the rest are computed
+    double t0 = Time::now();
+    feats.resize(poses.size());
+    vector<FeatBatch::Job> jobs;
+    vector<size_t> jobPoses;
+    vector<string> jobKeys;
+    for (size_t p = 0; p < poses.size(); ++p){
+        if ((poses[p].rows() != 4) || (poses[p].cols() != 4)){
+            fprintf(stdout,"Pose %d is not a 4x4 matrix. \n", (int)p);
+            feats.clear();
+            return feats;
+        }
+        feats[p].toolname = cloudname;
+        feats[p].orientation = poses[p];
+
+        string key = FeatCache::makeKey(modelHash, poses[p], descriptorParams());
+        if (!featCache.get(key, feats[p].toolFeats)){
+            FeatBatch::Job job;
+            job.pose = CloudUtils::yarpMat2eigMat(poses[p]);
+            jobs.push_back(job);
+            jobPoses.push_back(p);
+            jobKeys.push_back(key);
+        }
+    }
+
+    FeatBatch batch(descName, maxDepth, binsPerDim, sparseHist);
+    if (!batch.run(cloud_orig, normals_orig, jobs, max(threads, 1))){
+        fprintf(stdout,"3D Features not computed correctly. \n");
+        feats.clear();
+        return feats;
+    }
+
+    for (size_t j = 0; j < jobs.size(); ++j){
+        featCache.put(jobKeys[j], jobs[j].feats);
+        feats[jobPoses[j]].toolFeats.swap(jobs[j].feats);
+    }
+    if (verbose){
+        fprintf(stdout,"Features at %d poses (%d from cache) in %.3f s. \n", (int)poses.size(), (int)(poses.size() - jobs.size()), Time::now() - t0);
+    }
+    return feats;
+}
+
 /**********************************************************/
 bool ToolFeatExt::getSamples(const int n, const double deg)
 {
@@ -198,7 +349,7 @@ bool ToolFeatExt::getSamples(const int n, const double deg)
             fprintf(stdout,"Error transforming frame to canonical position . \n");
         }
 
-        if (!computeOMSEGI()) {
+        if (!computeFeats()) {
             fprintf(stdout,"Error computing features. \n");
         }
     }
@@ -272,14 +423,7 @@ bool ToolFeatExt::setPose(const Matrix& toolPose)
 bool ToolFeatExt::setCanonicalPose(const double deg, const int disp)
 {   // Rotates the tool model 'deg' degrees around the hand -Y axis
     // Positive angles turn the end effector "inwards" wrt the iCub, while negative ones rotate it "outwards" (for tool on the right hand).
-    float rad = deg*M_PI/180.0; // converse deg into rads
-
-    Vector oy(4);   // define the rotation over the Y axis (that is the one that we consider for tool orientation -left,front,right -
-    oy[0]=0.0; oy[1]=-1.0; oy[2]=0.0; oy[3]= rad; // XXX This is the RIGHT WAY, becasue the tool is along the -Y axis!!
-    //oy[0]=0.0; oy[1]=1.0; oy[2]=0.0; oy[3]= rad;
-
-    Matrix toolPose = axis2dcm(oy); // from axis/angle to rotation matrix notation
-    toolPose(1,3) = -disp /100.0;   // This accounts for the traslation of 'disp' in the -Y axis in the hand coord system along the extended thumb).
+    Matrix toolPose = canonicalPose(deg, disp);
 
     int ok =  transform2pose(toolPose);
     if (ok>=0) {
@@ -291,9 +435,124 @@ bool ToolFeatExt::setCanonicalPose(const double deg, const int disp)
     }
 }
 
+/**********************************************************/
+bool ToolFeatExt::buildDataset(const string& file, const int n_samples, const int threads)
+{   // Offline version of getAllToolFeats: poses are processed in parallel and written to a file, without visualization nor delays.
+    // File format (host byte order):
+    //   header: "TOOLFEAT", int32 version (2), int32 descriptor name length, descriptor name, int32 maxDepth, int32 binsPerDim,
+    //           int32 values per record, int32 records
+    //   record: int32 name length, name, float64 orientation (deg), int32 sample, float32 pose[16] (row-major),
+    //           float32 features[values per record] (the vectors of the descriptor, one after another)
+    ofstream out(file.c_str(), ios::out | ios::binary);
+    if (!out.is_open()){
+        fprintf(stdout,"Could not open dataset file %s \n", file.c_str());
+        return false;
+    }
+
+    int version = 2;
+    int descLength = descName.size();
+    int numValues = -1;         // known after the first record
+    int numRecords = 0;
+    out.write("TOOLFEAT", 8);
+    out.write((const char*)&version, sizeof(int));
+    out.write((const char*)&descLength, sizeof(int));
+    out.write(descName.c_str(), descLength);
+    out.write((const char*)&maxDepth, sizeof(int));
+    out.write((const char*)&binsPerDim, sizeof(int));
+    streampos countsPos = out.tellp();
+    out.write((const char*)&numValues, sizeof(int));
+    out.write((const char*)&numRecords, sizeof(int));
+
+    float maxVar = 3;       // Maximum variation, on degrees, wrt the canonical orientation (as in getSamples)
+    int samplesPerOri = max(n_samples, 1);
+    RandScalar randDataset(1);  // Own generator with a fixed seed, so that the same dataset is generated on every run
+                                // without reseeding the one getSamples uses
+
+    FeatBatch batch(descName, maxDepth, binsPerDim, sparseHist);
+    double t0 = Time::now();
+
+    int iniTool = 0;
+    if (robot ==  "icubSim")
+        iniTool = 1;    // in sim model 0 is the cube, so skip it
+
+    for (int toolI = iniTool ; toolI <models.size(); toolI++)
+    {
+        string meshName = models[toolI].get(2).asString();
+        string cloudName = meshName.substr(0,meshName.rfind('.'));  //remove format
+
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr modelCloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+        pcl::PointCloud<pcl::Normal>::Ptr modelNormals(new pcl::PointCloud<pcl::Normal>);
+        if (!CloudUtils::loadCloud(cloudpath, modelFile(cloudName), modelCloud)){
+            cout << "Couldn't load model for tool " << cloudName << endl;
+            return false;
+        }
+        computeNormals(modelCloud, modelNormals);
+
+        // Orientations 90, 0 and -90, in that order, and samples around each of them
+        vector<FeatBatch::Job> jobs;
+        vector<double> jobDegs;
+        for ( int deg = 90; deg > -100; deg = deg - 90){
+            for (int s = 0; s < samplesPerOri; ++s){
+                double degSample = (n_samples >= 1) ? deg + randDataset.get()*maxVar*2 - maxVar : deg;
+                FeatBatch::Job job;
+                job.pose = CloudUtils::yarpMat2eigMat(canonicalPose(degSample));
+                jobs.push_back(job);
+                jobDegs.push_back(degSample);
+            }
+        }
+
+        if (!batch.run(modelCloud, modelNormals, jobs, max(threads, 1))){
+            cout << "Features of tool " << cloudName << " not computed correctly." << endl;
+            return false;
+        }
+
+        // Write the records in job order
+        for (size_t j = 0; j < jobs.size(); ++j)
+        {
+            int nameLength = cloudName.size();
+            int sample = j % samplesPerOri;
+            out.write((const char*)&nameLength, sizeof(int));
+            out.write(cloudName.c_str(), nameLength);
+            out.write((const char*)&jobDegs[j], sizeof(double));
+            out.write((const char*)&sample, sizeof(int));
+            for (int r = 0; r < 4; ++r)
+                for (int c = 0; c < 4; ++c){
+                    float value = jobs[j].pose(r,c);
+                    out.write((const char*)&value, sizeof(float));
+                }
+
+            vector<float> feats;
+            for (size_t h = 0; h < jobs[j].feats.size(); ++h)
+                feats.insert(feats.end(), jobs[j].feats[h].begin(), jobs[j].feats[h].end());
+            if (numValues < 0){
+                numValues = feats.size();
+            }else if ((int)feats.size() != numValues){
+                cout << "Features of tool " << cloudName << " have " << feats.size() << " values instead of " << numValues << "." << endl;
+                return false;
+            }
+            if (!feats.empty())
+                out.write((const char*)&feats[0], feats.size()*sizeof(float));
+            numRecords++;
+        }
+        cout << "Tool " << cloudName << ": " << jobs.size() << " samples written." << endl;
+    }
+
+    numValues = max(numValues, 0);
+    out.seekp(countsPos);
+    out.write((const char*)&numValues, sizeof(int));
+    out.write((const char*)&numRecords, sizeof(int));
+    out.close();
+
+    fprintf(stdout,"Dataset of %d samples written to %s in %.1f s. \n", numRecords, file.c_str(), Time::now() - t0);
+    return !out.fail();
+}
+
 /**********************************************************/
 bool ToolFeatExt::setBinNum(const int binsN)
-{
+{   // Checked against every descriptor, so that setDescriptor does not fail later on
+    if (!Descriptor3D::checkParams(maxDepth, binsN) || !descriptor->setParams(maxDepth, binsN)){
+        return false;
+    }
     binsPerDim = binsN;
     return true;
 }
@@ -301,6 +560,9 @@ bool ToolFeatExt::setBinNum(const int binsN)
 /**********************************************************/
 bool ToolFeatExt::setDepth(const int depthN)
 {
+    if (!Descriptor3D::checkParams(depthN, binsPerDim) || !descriptor->setParams(depthN, binsPerDim)){
+        return false;
+    }
     maxDepth = depthN;
     return true;
 }
@@ -320,6 +582,65 @@ bool ToolFeatExt::setName(const string& name)
     return true;
 }
 
+/**********************************************************/
+bool ToolFeatExt::waitCloud(const int seq, const double timeout)
+{   // Waits until the cloud 'seq' has been received, so that the next getFeats is computed on it.
+    if (seq < 0){
+        fprintf(stdout,"Cloud sequence numbers start at 0. \n");
+        return false;
+    }
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr received;
+    double t0 = Time::now();
+    cloudsInPort.expect(seq);
+    while (!cloudsInPort.takeExpected(received))
+    {
+        if ((timeout > 0.0) && (Time::now() - t0 > timeout)){
+            cloudsInPort.expect(-1);
+            fprintf(stdout,"Cloud %d not received within %.1f s. \n", seq, timeout);
+            return false;
+        }
+        Time::delay(0.005);
+    }
+    useReceivedCloud(received, seq);
+    return true;
+}
+
+/**********************************************************/
+bool ToolFeatExt::setDescriptor(const string& name)
+{   // All descriptors are computed from the same normals and bounding box, and cached separately.
+    Descriptor3D *newDescriptor = Descriptor3D::create(name, maxDepth, binsPerDim, sparseHist);
+    if (newDescriptor == NULL){
+        return false;
+    }
+    delete descriptor;
+    descriptor = newDescriptor;
+    descName = name;
+    fprintf(stdout,"Features are computed with descriptor: %s\n", name.c_str());
+    return true;
+}
+
+/**********************************************************/
+bool ToolFeatExt::setFeatsFormat(const string& format)
+{
+    if ((format == "list") || (format == "compact") || (format == "compact8")){
+        featsFormat = format;
+        fprintf(stdout,"Features are sent as : %s\n", format.c_str());
+        return true;
+    }
+    fprintf(stdout,"Features format can only be list, compact or compact8. \n");
+    return false;
+}
+
+/**********************************************************/
+bool ToolFeatExt::clearCache()
+{
+    int size, hits, misses;
+    featCache.getStats(size, hits, misses);
+    fprintf(stdout,"Feature cache had %d entries, %d hits and %d misses. \n", size, hits, misses);
+    featCache.clear();
+    return true;
+}
+
 /**********************************************************/
 bool ToolFeatExt::setVerbose(const string& verb)
 {
@@ -382,13 +703,18 @@ bool ToolFeatExt::loadModelsFromFile(ResourceFinder &rf)
 }
 
 /************************************************************************/
-bool ToolFeatExt::loadToolModel(const std::string &tool)
+string ToolFeatExt::modelFile(const std::string &tool)
 {
-    string fileName;
     if (robot == "icubSim"){
-        fileName = "sim/"+ tool;}
+        return "sim/"+ tool;}
     else{
-        fileName = "real/"+ tool;}
+        return "real/"+ tool;}
+}
+
+/************************************************************************/
+bool ToolFeatExt::loadToolModel(const std::string &tool)
+{
+    string fileName = modelFile(tool);
 
     cout << endl <<" +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ " << endl;
     cout << "Loading tool model cloud from file" << cloudpath << fileName << endl;
@@ -398,18 +724,49 @@ bool ToolFeatExt::loadToolModel(const std::string &tool)
     cloud_orig->clear();
     cloudTransformed = false;
     rotMat = eye(4,4);
+    cloudsInPort.discard();     // the model replaces any cloud received before
 
     if (CloudUtils::loadCloud(cloudpath, fileName, cloud_orig))
     {
         cout << "Loaded tool model of size: " << cloud_orig->points.size () << endl;
         cloudLoaded = true;
 
+        // Normals are computed once per model, and rotated along with it afterwards
+        computeNormals(cloud_orig, normals_orig);
+        normalsReady = false;
+        modelHash = FeatCache::hashCloud(*cloud_orig);
+
         sendCloud(cloud_orig);
         return true;
     }
     return false;
 }
 
+/************************************************************************/
+bool ToolFeatExt::takeReceivedCloud()
+{   // Makes the last cloud received on clouds:i, if it has not been taken yet, the cloud to extract features from.
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr received;
+    int seq;
+    if (!cloudsInPort.take(received, seq))
+        return false;
+
+    useReceivedCloud(received, seq);
+    return true;
+}
+
+/************************************************************************/
+void ToolFeatExt::useReceivedCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr received, const int seq)
+{   // Replaces the model by a cloud received on clouds:i as the cloud to extract features from.
+    cout<< "Received cloud " << seq << " of size: " << received->points.size() << endl;
+    cloud = received;
+    sendCloud(cloud);
+    cloudTransformed = true;
+    cloudLoaded =true;
+    normalsReady = false;       // computed on demand, as the cloud has no model to take them from
+    cloudHash = FeatCache::hashCloud(*cloud);
+    cloudPose = eye(4,4);
+}
+
 /************************************************************************/
 // toolPose is represented by the transformation matrix of the explored object wrt the canonical position.
 // It shall be computed by a previous fucntion/module as the transformation matrix obtained when
@@ -432,9 +789,16 @@ bool ToolFeatExt::transform2pose(const Matrix &toolPose)
     // format YARP Matrix yo Eigen Matrix
     Eigen::Matrix4f TM = CloudUtils::yarpMat2eigMat(toolPose);
 
-    // Execute the transformation
+    // Execute the transformation, which replaces any cloud received before
+    cloudsInPort.discard();
     pcl::transformPointCloud(*cloud_orig , *cloud, TM);
 
+    // Normals of the rigidly transformed cloud are the rotated normals of the model
+    FeatBatch::transformNormals(*normals_orig, TM, *normals);
+    normalsReady = true;
+    cloudHash = modelHash;
+    cloudPose = toolPose;
+
     if (verbose){	printf("Transformation done \n");	}
 
     rotMat = toolPose;
@@ -446,10 +810,13 @@ bool ToolFeatExt::transform2pose(const Matrix &toolPose)
 }
 
 /************************************************************************/
-int ToolFeatExt::computeOMSEGI()
+int ToolFeatExt::computeFeats()
     {
     cout << endl <<" +++++++++++++++++++++++++++++ FEATURE EXTRACTION ++++++++++++++++++++++++++++++++++++ " << endl;
 
+    // A cloud received since the last extraction is used as it is, whether it was waited for or not
+    takeReceivedCloud();
+
     if (!cloudLoaded){
         if (!loadToolModel(cloudname))
         {
@@ -463,445 +830,123 @@ int ToolFeatExt::computeOMSEGI()
         transform2pose();
     }
     
-    cout << "Computing Features to maximum depth = " << maxDepth <<  "." << endl;
-    
-    /* ===========================================================================*/
-    cout << "Getting AABB" <<endl;
-    pcl::PointXYZRGB min_point_AABB;
-    pcl::PointXYZRGB max_point_AABB;
-    min_point_AABB.x = 0; min_point_AABB.y = 0; min_point_AABB.z = 0;
-    max_point_AABB.x = 0; max_point_AABB.y = 0; max_point_AABB.z = 0;
-    for (int p=0;p < cloud->points.size(); p++)
-    {
-        pcl::PointXYZRGB *point = &cloud->at(p);
-
-        if (point->x > max_point_AABB.x)
-            max_point_AABB.x = point->x;
-        if (point->y > max_point_AABB.y)
-            max_point_AABB.y = point->y;
-        if (point->z > max_point_AABB.z)
-            max_point_AABB.z = point->z;
-
-        if (point->x < min_point_AABB.x)
-            min_point_AABB.x = point->x;
-        if (point->y < min_point_AABB.y)
-            min_point_AABB.y = point->y;
-        if (point->z < min_point_AABB.z)
-            min_point_AABB.z = point->z;
+    if (!descriptor->setParams(maxDepth, binsPerDim)){
+        return -1;
     }
 
-    max_point_AABB.y = 0; // Limit the bounding box to the bottom of the hand, so only the "usable" part of the tool gets represented.
-    cout << "Computing voxel side length" <<endl;
-    double BBlengthX = fabs(max_point_AABB.x - min_point_AABB.x);
-    double BBlengthY = fabs(max_point_AABB.y - min_point_AABB.y);
-    double BBlengthZ = fabs(max_point_AABB.z - min_point_AABB.z);
-
-    cout << "Voxel side length computed" <<endl;
-
-    double maxSize = max(max(BBlengthX,BBlengthY), BBlengthZ);
-    cout << "Lenght of the larger size is = " << maxSize <<  "." << endl;
-    
-    /* =========================================================================== */
-    // Divide the bounding box in subregions using octree, and compute the normal histogram (EGI) in each of those subregions at different levels.
-
-    // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    // Create instances of necessary classes
-
-    // octree
-    float minVoxSize = (maxSize+0.01)/2; // Min voxel size (max resolution) 1 cm
-    pcl::octree::OctreePointCloudSearch<pcl::PointXYZRGB> octree(minVoxSize);
-
-    // Normal estimation class, and pass the input dataset to it
-    pcl::NormalEstimation<pcl::PointXYZRGB, pcl::Normal> ne;
-
-    // Create an empty kdtree representation, and pass it to the normal estimation object.
-    // Its content will be filled inside the object, based on the given input dataset (as no other search surface is given).
-    pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZRGB> ());
-    ne.setSearchMethod (tree);
-
-    // Cloud of Normals from whole pointcloud
-    pcl::PointCloud<pcl::Normal>::Ptr cloud_normals (new pcl::PointCloud<pcl::Normal> ());
-
-    // voxelCloud and voxelCloudNormals to contain the poitns on each voxel
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr voxelCloud(new pcl::PointCloud<pcl::PointXYZRGB> ());
-    pcl::PointCloud<pcl::Normal>::Ptr voxelCloudNormals(new pcl::PointCloud<pcl::Normal> ());
-
-    // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    cout << "Iinitializing octree" << endl;
-    // Initialize octree
-    //create octree structure
-    octree.setInputCloud(cloud);
-    //update bounding box automatically
-    octree.defineBoundingBox(min_point_AABB.x, min_point_AABB.y, min_point_AABB.z,
-                             max_point_AABB.x, max_point_AABB.y, max_point_AABB.z);
-    //add points in the tree
-    octree.addPointsFromInputCloud();
-
-
-    // Initialize histogram variables
-    float rangeMin = -1;
-    float rangeMax = 1;
-    float rangeValid = rangeMax - rangeMin;
-    float sizeBin = rangeValid/binsPerDim;
-
-    std::vector < std::vector < double > > featureVectorOccVox;     // Vector containing histograms for occupied voxels
     ToolFeat3DwithOrient featureVectorAllVox;     // Vector containing histograms for all voxels, also the empty ones
     featureVectorAllVox.toolname = cloudname;
     featureVectorAllVox.orientation = rotMat;
-    //std::vector < std::vector < float > > featureVectorAllVox;     // Vector containing histograms for all voxels, also the empty ones
-    // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    // Find the minimum resolution octree (depth =1) to start increase it from there
-
-    double cBB_min_x, cBB_min_y, cBB_min_z, cBB_max_x, cBB_max_y, cBB_max_z;
-    octree.getBoundingBox(cBB_min_x, cBB_min_y, cBB_min_z, cBB_max_x, cBB_max_y, cBB_max_z);
-    double cBBsize = fabs(cBB_max_x - cBB_min_x);           // size of the cubic bounding box encompasing the whole pointcloud
-
-    if(verbose){
-        cout << "AA BB: (" << min_point_AABB.x << "," << min_point_AABB.y << "," << min_point_AABB.z << "), (" << max_point_AABB.x << "," <<max_point_AABB.y << "," << max_point_AABB.z << ")" << endl;
-        cout << "Octree BB: (" << cBB_min_x << "," << cBB_min_y << "," <<cBB_min_z << "), (" << cBB_max_x << "," <<cBB_max_y << "," <<cBB_max_z << ")" << endl;
-    }
-
-    // re-initialize tree with new resolution
-    minVoxSize = cBBsize/2;     //Update to minimum resolution
-    octree.deleteTree();
-    octree.setResolution(minVoxSize);
-    octree.defineBoundingBox(cBB_min_x, cBB_min_y, cBB_min_z,
-                             cBB_max_x, cBB_max_y, cBB_max_z);
-    octree.setInputCloud(cloud);
-    octree.addPointsFromInputCloud();
-
-
-    // Compute all normals from the orignial cloud, and THEN subdivide into voxels (to avoid voxel boundary problems arising when computing normals voxel-wise)
-    cout << "Computing cloud normals" << endl;
-    // Clear output cloud
-    cloud_normals->points.clear();
-
-    // Pass the input cloud to the normal estimation class
-    ne.setInputCloud (cloud);
-
-    // Use all neighbors in a sphere of radius of size of the voxel length
-    ne.setRadiusSearch (0.05);//(minVoxSize/2);
-
-    // Compute the normals
-    ne.compute (*cloud_normals);
 
+    // Features of the same model at the same pose are reused
+    string cacheKey = FeatCache::makeKey(cloudHash, cloudPose, descriptorParams());
+    if (featCache.get(cacheKey, featureVectorAllVox.toolFeats)){
+        cout << "Features found in cache." << endl;
+    }else{
+        cout << "Computing " << descName << " features to maximum depth = " << maxDepth <<  "." << endl;
 
-    // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    // Perform feature extraction iteratively on increasingly smaller voxels up to maxDepth level.
-    for (int depth = 0; depth<=maxDepth; ++depth)
-    {
-        if(verbose){cout << endl << "====================== Depth:" << depth << " ========================== " << endl;}
-
-
-        if (depth ==0 ){ // At depth 0, compute the normal histogram for the whole object.
-            /* =================================================================================*/
-            // Compute the EGI (sphere normal histogram). Normalize and add it to the feature vector.
-
-            float cloudHist[binsPerDim][binsPerDim][binsPerDim];     // Histogram 3D matrix per voxel
-
-            // Initialize histogram for new voxel
-            for (int i = 0; i < binsPerDim; ++i)
-                for (int j = 0; j < binsPerDim; ++j)
-                    for (int k = 0; k < binsPerDim; ++k)
-                       cloudHist[i][j][k] = 0.0f;
-
-            // Compute normal histogram looping through normals in voxel.
-            unsigned int okNormals = 0;
-            unsigned int nanCount= 0;
-            for (size_t i = 0; i < cloud_normals->points.size (); ++i)
-            {
-                int xbin, ybin, zbin;
-                float xn, yn, zn;
-
-                if ((pcl::isFinite(cloud_normals->points[i]))){
-                    xn = cloud_normals->points[i].normal_x;
-                    yn = cloud_normals->points[i].normal_y;
-                    zn = cloud_normals->points[i].normal_z;
-                    //std::cout << "Normal  (" << xn << "," << yn << "," << zn << ")" << std::endl;
-
-                    xbin = floor((xn - rangeMin) /sizeBin); // floor because 0-indexed array
-                    ybin = floor((yn - rangeMin) /sizeBin);
-                    zbin = floor((zn - rangeMin) /sizeBin);
-                    //std::cout << "lies on bin (" << xbin << "," << ybin << "," << zbin << ")" << std::endl;
-
-                    cloudHist[xbin][ybin][zbin]= cloudHist[xbin][ybin][zbin] + 1.0f;
-                    okNormals ++;
-                }else{
-                    nanCount++;
-                    //std::cout << "Normal is NaN." << std::endl;
+        /* =========================================================================== */
+        // Use the normals of the whole cloud, and THEN subdivide into voxels (to avoid voxel boundary problems arising when computing normals voxel-wise)
+        if (!normalsReady){
+            computeNormals(cloud, normals);
+            normalsReady = true;
+        }
 
-                }
-            }   //- close loop over normal points in voxel
-            std::cout << "." ;
-            std::cout << "Cloud has " << okNormals << " valid points and " << nanCount << " NaNs." << std::endl;
-            std::vector< double> featVecHist;                                   // Vector containing a serialized version of the 3D histogram
-            //Normalize by the total number of points in voxel so that each histogram has sum 1, independent of the number of points in the voxel.
-            for (int i = 0; i < binsPerDim; ++i){
-                for (int j = 0; j < binsPerDim; ++j){
-                    for (int k = 0; k < binsPerDim; ++k){
-                        if (okNormals){              // Avoid dividing by 0.
-                            cloudHist[i][j][k] = cloudHist[i][j][k] / (float) okNormals;}
-
-                        // Push into feature vector per histogram
-                        featVecHist.push_back(cloudHist[i][j][k]);
-                    }
-                }
-            }
+        /* ===========================================================================*/
+        // Cubic bounding box of the usable part of the tool, and voxels of the points, shared by all descriptors
+        DescriptorInput input(cloud, normals);
 
-            featureVectorAllVox.toolFeats.push_back(featVecHist);       // copy histogram to sendout data
+        if(verbose){
+            const Eigen::Vector3f &cBBmin = input.getBBMin();
+            cout << "Cubic BB: (" << cBBmin.x() << "," << cBBmin.y() << "," << cBBmin.z() << "), side " << input.getBBSize() << endl;
         }
-        else
-        {
-            featureVectorOccVox.clear();                                // Clear the vector which saves all populated histograms at depth level
-
-            int voxPerSide = pow(2,depth);
-            bool voxelOccupancy[voxPerSide][voxPerSide][voxPerSide];    // Keeps record of the position of the occupied voxels at each depth.
-            for (int i = 0; i < voxPerSide; ++i)                        // initialize all positions to false
-                for (int j = 0; j < voxPerSide; ++j)
-                    for (int k = 0; k < voxPerSide; ++k)
-                       voxelOccupancy[i][j][k] = false;
-
-            // Instantiate normal histogram at actual depth
-            int numLeaves = octree.getLeafCount();                              // Get the number of occupied voxels (leaves) at actual depth
-            int histSize = pow(binsPerDim,3);
-            float voxelHist[numLeaves][binsPerDim][binsPerDim][binsPerDim];     // Histogram 3D matrix per occupied voxel
-            float voxelsHistMat[voxPerSide][voxPerSide][voxPerSide][histSize]; // Matrix containing the normal histogram at each voxel at actual depth.
-
-            //std::vector< double> featVecHist;                                   // Vector containing a serialized version of the 3D histogram
-
-            if(verbose){
-                cout << "BB divided into " << voxPerSide << " voxels per side of size "<< minVoxSize << ", " << numLeaves << " occupied." << endl;
-                cout << "Looping through the  " << numLeaves << " occupied voxels." << endl;
-            }
 
-            // Extracts all the points at leaf level from the octree
-            int octreePoints = 0;
-            int voxelI = 0;
-            int nanCount = 0;
-            pcl::octree::OctreePointCloudSearch<pcl::PointXYZRGB>::LeafNodeIterator tree_it;
-            pcl::octree::OctreePointCloudSearch<pcl::PointXYZRGB>::LeafNodeIterator tree_it_end = octree.leaf_end();
-
-            // Iterate through lower level leafs (voxels).
-            for (tree_it = octree.leaf_begin(depth); tree_it!=tree_it_end; ++tree_it)
-            {
-                //std::cout << "Finding points within voxel " << voxelI << std::endl;
-
-                // Clear clouds and vectors from previous voxel.
-                voxelCloud->points.clear();
-                voxelCloudNormals->points.clear();
-                //featVecHist.clear();
-
-                // Find Voxel Bounds ...
-                Eigen::Vector3f voxel_min, voxel_max;
-                octree.getVoxelBounds(tree_it, voxel_min, voxel_max);
-
-                //... and center
-                pcl::PointXYZRGB voxelCenter;
-                voxelCenter.x = (voxel_min.x() + voxel_max.x()) / 2.0f;
-                voxelCenter.y = (voxel_min.y() + voxel_max.y()) / 2.0f;
-                voxelCenter.z = (voxel_min.z() + voxel_max.z()) / 2.0f;
-
-                // Mark octree leaves as occupied voxels.
-                int occx, occy, occz;                                  // voxel indices
-                occx = floor((voxelCenter.x - cBB_min_x) /minVoxSize); // floor because 0-indexed array
-                occy = floor((voxelCenter.y - cBB_min_y) /minVoxSize);
-                occz = floor((voxelCenter.z - cBB_min_z) /minVoxSize);
-                //std::cout << "Voxel (" << occx << "," << occy << "," << occz << ") is occupied" << std::endl;
-                voxelOccupancy[occx][occy][occz]= true;
-
-                //std::cout << "Voxel center at ("
-                //            << voxelCenter.x << " "
-                //            << voxelCenter.y << " "
-                //            << voxelCenter.z << ")" << std::endl;
-
-                // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-                // Neighbors within voxel search
-                // It assigns the search point to the corresponding leaf node voxel and returns a vector of point indices.
-                // These indices relate to points which fall within the same voxel.
-                std::vector<int> voxelPointsIdx;
-                if (octree.voxelSearch (voxelCenter, voxelPointsIdx))
-                {
-                    for (size_t i = 0; i < voxelPointsIdx.size (); ++i)
-                    {
-                        // Save Points within voxel as cloud
-                        voxelCloud->points.push_back(cloud->points[voxelPointsIdx[i]]);
-                        voxelCloudNormals->points.push_back(cloud_normals->points[voxelPointsIdx[i]]);
-
-                        octreePoints++;
-                    } // for point in voxel
-                }
-                //std::cout << "Voxel has " << voxelCloud->points.size() << " points. " << std::endl;
-
-
-                /* =================================================================================*/
-                // On each voxel compute the EGI (sphere normal histogram). Normalize and send it out as feature vector.
-
-                // Initialize histogram for new voxel
-                for (int i = 0; i < binsPerDim; ++i)
-                    for (int j = 0; j < binsPerDim; ++j)
-                        for (int k = 0; k < binsPerDim; ++k)
-                           voxelHist[voxelI][i][j][k] = 0.0f;
-
-                // Compute normal histogram looping through normals in voxel.
-                unsigned int okNormalsVox = 0;
-                unsigned int nanCountVox = 0;
-                for (size_t i = 0; i < voxelCloudNormals->points.size (); ++i)
-                {
-                    int xbin, ybin, zbin;
-                    float xn, yn, zn;
-
-                    if ((pcl::isFinite(voxelCloudNormals->points[i]))){
-                        // Get normal orientation in each dimension
-                        xn = voxelCloudNormals->points[i].normal_x;
-                        yn = voxelCloudNormals->points[i].normal_y;
-                        zn = voxelCloudNormals->points[i].normal_z;
-                        //std::cout << "Normal  (" << xn << "," << yn << "," << zn << ")" << std::endl;
-
-                        // Get the bin of the normal orientation in each direction.
-                        xbin = floor((xn - rangeMin) /sizeBin); // floor because 0-indexed array
-                        ybin = floor((yn - rangeMin) /sizeBin);
-                        zbin = floor((zn - rangeMin) /sizeBin);
-                        //std::cout << "lies on bin (" << xbin << "," << ybin << "," << zbin << ")" << std::endl;
-
-                        // Increase count of the bin where the normal is assigned
-                        voxelHist[voxelI][xbin][ybin][zbin]= voxelHist[voxelI][xbin][ybin][zbin] + 1.0f;
-                        okNormalsVox ++;
-                    }else{
-                        nanCount++;
-                        nanCountVox++;
-                        //std::cout << "Normal is NaN." << std::endl;
-
-                    }
-                }   //- close loop over normal points in voxel
-                std::cout << "." ;
-                std::cout << "Voxel (" << occx << "," << occy << "," << occz << ")" << "has " << okNormalsVox << " valid points and " << nanCountVox << " NaNs." << std::endl;
-
-                //Normalize by the total number of points in voxel so that each histogram has sum 1, independent of the number of points in the voxel.
-                int n =0;
-                for (int i = 0; i < binsPerDim; ++i){
-                    for (int j = 0; j < binsPerDim; ++j){
-                        for (int k = 0; k < binsPerDim; ++k){
-                            if (okNormalsVox){              // Avoid dividing by 0.
-                                voxelHist[voxelI][i][j][k] = voxelHist[voxelI][i][j][k] / (float) okNormalsVox;
-                                voxelsHistMat[occx][occy][occz][n] = voxelHist[voxelI][i][j][k];
-                                n++;
-                            }
-
-                            // Push into feature vector per histogram
-                            //featVecHist.push_back(voxelHist[voxelI][i][j][k]);
-                        }
-                    }
-                }                
-
-                // Keep all histograms form occupied voxels
-                // featureVectorOccVox.push_back(featVecHist);
-
-                // XXX Need a 3D matrix structure of histograms so I can retrieve them basedon its voxel index
-                // instead of based on a line index which I dont know if its matching. Something like:
-                //voxelsHistMat[occx][occy][occz] = featVecHist;
-
-                // Voxel histograms coincide with voxels set as occupied (obviously), otherwise they are filled with all 0s.
-
-
-
-                voxelI++;
-
-                // Print out angular histogram
-                /*
-                cout << "Angular histogram: " << std::endl << "{";
-                for (int i = 0; i < binsPerDim; ++i){
-                    cout <<  "[" ;
-                    for (int j = 0; j < binsPerDim; ++j){
-                        for (int k = 0; k < binsPerDim; ++k)
-                           cout << voxelHist[voxelI][i][j][k] << "," ;
-                        cout <<  std::endl;
-                    }
-                    cout <<  "]" ;
-                }
-                cout <<  "}" <<std::endl;
-                // */
-
-            } // close for voxel
+        /* =========================================================================== */
+        // For OMS-EGI, divide the bounding box in voxels at every depth up to maxDepth, and compute the normal histogram (EGI) in each of them.
+        int usedPoints = descriptor->compute(input, featureVectorAllVox.toolFeats);
+        if (usedPoints < 0){
+            return -1;
+        }
+        featCache.put(cacheKey, featureVectorAllVox.toolFeats);
 
-            // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-            // Print out security checks
+        if(verbose){
+            cout << "Cloud has " << cloud->points.size() << " points, " << usedPoints << " used by the descriptor." << endl;
+            descriptor->printStats();
+        }
+    }
 
-            // Check that all methods end with the same number of points, to avoid missing or repetition.
-            if(verbose){
-                cout << "Point Cloud has " << cloud->points.size() << " points." << endl;
-                cout << "Normals Cloud has " << cloud->points.size() << " points, of which "<< nanCount << " are NaNs" << endl;
-                cout << "Octree found " << octreePoints << " points." << endl;
-            }
+    if(verbose){
+        const vector<vector<double> > &toolFeats = featureVectorAllVox.toolFeats;
+        cout << "Vector has a size of " << toolFeats.size() << " x " << (toolFeats.empty() ? 0 : toolFeats[0].size()) << endl;
+    }
 
-            // Print out voxel occupancy and stream out histograms
-            // /*
-            if(verbose){
-                cout << "Voxel Occupancy: " << std::endl << "{";
-                for (int i = 0; i < voxPerSide; ++i){
-                    cout <<  "[" ;
-                    for (int j = 0; j < voxPerSide/2; ++j){    //Limit bounding box to the upper part of the tool only, to remove handle from feature list.
-
-                        for (int k = 0; k < voxPerSide; ++k){
-                           cout << voxelOccupancy[i][j][k] << "," ;
-                        }
-                        cout <<  std::endl;
-                    }
-                    cout <<  "]" ;
-                }
-                cout <<  "}" <<std::endl;
-            }
-            //*/
-
-            // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-            // Fill the complete feature vector, including histograms for empty voxels.
-            int occVoxI = 0;
-            std::vector< double > histVec;
-            for (int i = 0; i < voxPerSide; ++i){
-                for (int j = 0; j < voxPerSide/2; ++j){   //Limit bounding box to the upper part of the tool only, to remove handle from feature list.
-                    for (int k = 0; k < voxPerSide; ++k){
-                        if (voxelOccupancy[i][j][k]){        // if the voxel is occupied
-                            histVec.clear();
-                            for (int n = 0; n <histSize; ++n){
-                                histVec.push_back(voxelsHistMat[i][j][k][n]);}
-                            //histVec = featureVectorOccVox[occVoxI];
-                            featureVectorAllVox.toolFeats.push_back(histVec); // copy histogram
-                            occVoxI++;
-                        }else{                               // if the voxel is empty fill with 0s.
-                            std::vector< double >  zeroVector(pow(binsPerDim,3),0.0f);
-                            featureVectorAllVox.toolFeats.push_back(zeroVector); // fill with the same amount of zeros
-                        }
-                    }
-                }
+    // Send the features out, as a list of histograms or as a compact message (for descriptors made of normal histograms)
+    int codecBins = descriptor->getBinsPerDim();
+    if ((featsFormat != "list") && (codecBins == 0)){
+        cout << descName << " features can not be sent as " << featsFormat << ", sending them as a list." << endl;
+    }
+    if ((featsFormat == "list") || (codecBins == 0)){
+        feat3DoutPort.write(featureVectorAllVox);
+    }else{
+        ToolFeat3DCompact featsCompact;
+        if (!FeatCodec::pack(featureVectorAllVox, maxDepth, codecBins, featsFormat == "compact8", featsCompact)){
+            return -1;
+        }
+        if(verbose){
+            cout << "Compact features: " << featsCompact.values.size() + featsCompact.occupancy.size() << " bytes." << endl;
+
+            // Decode them back, as a reader would, to report the precision lost on the way
+            ToolFeat3DwithOrient featsDecoded;
+            if (!FeatCodec::unpack(featsCompact, featsDecoded) || (featsDecoded.toolFeats.size() != featureVectorAllVox.toolFeats.size())){
+                cout << "Compact features could not be decoded back." << endl;
+            }else{
+                double maxErr = 0.0;
+                for (size_t h = 0; h < featsDecoded.toolFeats.size(); h++)
+                    for (size_t b = 0; (b < featsDecoded.toolFeats[h].size()) && (b < featureVectorAllVox.toolFeats[h].size()); b++)
+                        maxErr = max(maxErr, fabs(featsDecoded.toolFeats[h][b] - featureVectorAllVox.toolFeats[h][b]));
+                cout << "Compact features decode back with a maximum error of " << maxErr << "." << endl;
             }
-
-            if(verbose){cout <<  "Vector has a size of " << featureVectorAllVox.toolFeats.size() << " x " << histSize << " at depth "<< depth <<endl;}
-
-            // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-            // Re-initialize octree with double resolution (half minVoxSize) to analyse next level
-            minVoxSize = minVoxSize/2;
-            octree.deleteTree();
-            octree.setResolution(minVoxSize);       // re-initialize tree with new resolution
-            octree.defineBoundingBox(cBB_min_x, cBB_min_y, cBB_min_z,
-                                     cBB_max_x, cBB_max_y, cBB_max_z);
-            octree.setInputCloud(cloud);
-            octree.addPointsFromInputCloud();
         }
+        feat3DoutPort.write(featsCompact);
     }
+
     if(verbose){
-        // print out end feature vector of vectors
-        cout << "Feature vector contains: " << endl << featureVectorAllVox.toString()<< endl;
         cout << endl << "====================== Feature Extraction Done ========================== " << endl;
     }
 
-    // Put featureVectorAllVox in a bottle and send it out.
-    feat3DoutPort.write(featureVectorAllVox);
-
     return true;
 }
 
 
 /***************** Helper Functions *************************************/
 
+string ToolFeatExt::descriptorParams()
+{
+    return descriptor->getParams();
+}
+
+Matrix ToolFeatExt::canonicalPose(const double deg, const int disp)
+{
+    float rad = deg*M_PI/180.0; // converse deg into rads
+
+    Vector oy(4);   // define the rotation over the Y axis (that is the one that we consider for tool orientation -left,front,right -
+    oy[0]=0.0; oy[1]=-1.0; oy[2]=0.0; oy[3]= rad; // XXX This is the RIGHT WAY, becasue the tool is along the -Y axis!!
+
+    Matrix toolPose = axis2dcm(oy); // from axis/angle to rotation matrix notation
+    toolPose(1,3) = -disp /100.0;   // This accounts for the traslation of 'disp' in the -Y axis in the hand coord system along the extended thumb).
+    return toolPose;
+}
+
+bool ToolFeatExt::computeNormals(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in, pcl::PointCloud<pcl::Normal>::Ptr normals_out)
+{
+    cout << "Computing cloud normals" << endl;
+
+    // Same normals as the descriptor benchmark, from all neighbors in a sphere of radius 5 cm
+    DescriptorInput::estimateNormals(cloud_in, *normals_out);
+
+    return true;
+}
+
 bool ToolFeatExt::sendCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_in)
 {
     Bottle &cloudBottle = cloudsOutPort.prepare();
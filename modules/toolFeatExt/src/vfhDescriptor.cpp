@@ -0,0 +1,56 @@
+#include "vfhDescriptor.h"
+
+#include <iostream>
+
+using namespace std;
+
+// Constructor
+VFHDescriptor::VFHDescriptor():
+    tree(new pcl::search::KdTree<pcl::PointXYZRGB> ())
+{
+    vfh.setSearchMethod(tree);
+}
+
+int VFHDescriptor::compute(DescriptorInput &input, vector<vector<double> > &feats)
+{
+    const pcl::PointCloud<pcl::PointXYZRGB> &cloud = *input.getCloud();
+    const pcl::PointCloud<pcl::Normal> &normals = *input.getNormals();
+
+    feats.assign(1, vector<double>(histSize, 0.0));
+    if (normals.size() != cloud.size()){
+        cout << "Cloud has " << cloud.size() << " points but " << normals.size() << " normals." << endl;
+        feats.clear();
+        return -1;
+    }
+
+    // Only the points with a finite normal are used
+    boost::shared_ptr<vector<int> > indices (new vector<int>);
+    indices->reserve(cloud.size());
+    for (size_t p = 0; p < cloud.size(); ++p){
+        const pcl::Normal &normal = normals.points[p];
+        if (pcl::isFinite(cloud.points[p]) && pcl_isfinite(normal.normal_x) && pcl_isfinite(normal.normal_y) && pcl_isfinite(normal.normal_z))
+            indices->push_back(p);
+    }
+    if (indices->size() < 2)
+        return indices->size();
+
+    vfh.setInputCloud(input.getCloud());
+    vfh.setInputNormals(input.getNormals());
+    vfh.setIndices(indices);
+    vfh.compute(signature);
+    if (signature.points.size() != 1){
+        cout << "VFH not computed correctly." << endl;
+        feats.clear();
+        return -1;
+    }
+
+    // Normalized to sum 1, as the other histograms
+    double sum = 0.0;
+    for (int b = 0; b < histSize; ++b)
+        sum += signature.points[0].histogram[b];
+    if (sum > 0.0)
+        for (int b = 0; b < histSize; ++b)
+            feats[0][b] = signature.points[0].histogram[b]/sum;
+
+    return indices->size();
+}
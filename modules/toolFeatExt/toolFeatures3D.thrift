@@ -34,6 +34,18 @@ struct ToolFeat3DwithOrient
 3: RotationMatrix orientation;          # Orientation with respect to the canonical position.
 }
 
+struct ToolFeat3DCompact
+{
+1: string toolname;
+2: RotationMatrix orientation;          # Orientation with respect to the canonical position.
+3: i32 maxDepth;
+4: i32 binsPerDim;
+5: i32 numHists;                        # Number of histograms of the full feature vector (whole tool + voxels).
+6: bool quantized;                      # Values as uint8 (value*255) instead of float32.
+7: binary occupancy;                    # One bit per histogram (LSB first), set if it is not all 0.
+8: binary values;                       # Values of the non-empty histograms only, in order, little-endian.
+}
+
 
 /**
 * tool3DFeat_IDLServer Interface.
@@ -47,6 +59,14 @@ service tool3DFeat_IDLServer
      */
     bool getFeats();
 
+    /**
+     * @brief getFeatsBatch - Performs 3D feature extraction of the tool at each of the given poses, in parallel, without transforming nor republishing the model.
+     * @param poses - (list of yarp::sig::Matrix) transformations of the tool model wrt its canonical pose.
+     * @param threads - (int) number of worker threads (default = 4).
+     * @return list of the features at each pose, in the same order (empty on failure, or if no model has been loaded, e.g. after a cloud received on clouds:i).
+     */
+    list<ToolFeat3DwithOrient> getFeatsBatch(1: list<RotationMatrix> poses, 2: i32 threads = 4);
+
 
     /**
      * @brief getFeats - Performs 3D feature extraction of all loaded tools
@@ -62,6 +82,16 @@ service tool3DFeat_IDLServer
      */
     bool getSamples(1: i32 n = 10, 2: double deg = 0.0);
 
+    /**
+     * @brief buildDataset - Computes the features of all loaded tools at orientations 90, 0 and -90 (n_samples around each)
+     * in parallel, and writes them to a binary file in a fixed order. Nothing is displayed nor sent through feats3D:o.
+     * @param file - (string) path of the dataset file.
+     * @param n_samples - (int) number of poses around each orientation (default = 1).
+     * @param threads - (int) number of worker threads (default = 4).
+     * @return true/false on success/failure of writing the dataset.
+     */
+    bool buildDataset(1: string file, 2: i32 n_samples = 1, 3: i32 threads = 4);
+
     /**
      * @brief loadModel - loads a model from a .pcd or .ply file for further processing.
      * @param cloudname - (string) name of the file to load cloud from (and path from base path if needed) (default = "cloud.ply") .
@@ -76,6 +106,16 @@ service tool3DFeat_IDLServer
      */
     bool setName(1: string cloudname = "cloud.ply");
 
+    /**
+     * @brief waitCloud - Waits until the cloud sent to clouds:i with the given sequence number (envelope count) is received,
+     * and makes it the cloud on which features are extracted. Clouds with other numbers, e.g. stale ones from a previous sender
+     * or those of other senders, do not end the wait.
+     * @param seq - (int) sequence number of the cloud.
+     * @param timeout - (double) maximum time to wait, in seconds (0 to wait indefinitely) (default = 2.0).
+     * @return true when received, false on timeout.
+     */
+    bool waitCloud(1: i32 seq, 2: double timeout = 2.0);
+
     /**
      * @brief setPose - Rotates the tool model according to any given rotation matrix
      * @param rotationMatrix - (yarp::sig::Matrix) rotation matrix to apply to the cloud.
@@ -95,6 +135,7 @@ service tool3DFeat_IDLServer
     /**
      * @brief setBinNum - sets the number of bins per angular dimension (yaw-pitch-roll) used to compute the normal histogram. Total number of bins per voxel = bins^3.
      * @param nbins - (int) desired number of bins per angular dimension. (default = 2, i.e. 8 bins per voxel).
+     * The value must be valid for every descriptor, not only the one in use.
      * @return true/false on success/failure of setting number of bins.
      */
     bool setBinNum(1: i32 nbins = 2);
@@ -102,10 +143,34 @@ service tool3DFeat_IDLServer
     /**
      * @brief setDepth - sets the number of times that the bounding box will be iteratively subdivided into octants. Total number of voxels = sum(8^(1:depth)).
      * @param maxDepth - (int) desired number of times that the bounding box will be iteratively subdivided into octants (default = 2, i.e. 72 vox).
+     * Every voxel gets a histogram (also with sparseHist), so the depth is limited to keep the features under 2^22 values:
+     * up to 6 with 2 or 3 bins, 5 with 4 or 5 bins. The value must be valid for every descriptor (at least 1 for occupancy), not only the one in use.
      * @return true/false on success/failure of setting maxDepth
      */
     bool setDepth(1: i32 maxDepth = 2);
 
+    /**
+     * @brief setDescriptor - selects the descriptor used to extract the features. All of them use the same normals and bounding box.
+     * @param name - (string) omsegi (normal histograms of the whole tool and of its voxels at every depth), occupancy (fraction of the
+     * points in each voxel at every depth) or vfh (a single Viewpoint Feature Histogram of 308 bins) (default = omsegi).
+     * @return true/false on success/failure of selecting the descriptor (e.g. unknown name or maxDepth out of its range).
+     */
+    bool setDescriptor(1: string name = "omsegi");
+
+    /**
+     * @brief setFeatsFormat - sets the message used to send the features through feats3D:o.
+     * @param format - (string) list (ToolFeat3DwithOrient), compact (ToolFeat3DCompact, float32) or compact8 (ToolFeat3DCompact, uint8).
+     * Compact formats apply to omsegi only, other descriptors are always sent as a list.
+     * @return true/false on success/failure of setting the format.
+     */
+    bool setFeatsFormat(1: string format = "list");
+
+    /**
+     * @brief clearCache - empties the in-memory cache of computed features (files of the disk cache are kept), and prints its statistics.
+     * @return true/false on success/failure.
+     */
+    bool clearCache();
+
     /**
      * @brief setVerbose - sets verbose of the output on or off.
      * @param verb - (string ON/OFF) desired state of verbose.
@@ -1,5 +1,5 @@
 ## This is an automatically-generated file.
 ## It could get re-generated if the ALLOW_IDL_GENERATION flag is on
 
-set(headers include/Point3D.h;include/ToolFeat3D.h;include/ToolFeat3DwithOrient.h;include/tool3DFeat_IDLServer.h)
-set(sources src/Point3D.cpp;src/ToolFeat3D.cpp;src/ToolFeat3DwithOrient.cpp;src/tool3DFeat_IDLServer.cpp)
+set(headers include/Point3D.h;include/ToolFeat3D.h;include/ToolFeat3DwithOrient.h;include/ToolFeat3DCompact.h;include/tool3DFeat_IDLServer.h)
+set(sources src/Point3D.cpp;src/ToolFeat3D.cpp;src/ToolFeat3DwithOrient.cpp;src/ToolFeat3DCompact.cpp;src/tool3DFeat_IDLServer.cpp)
@@ -0,0 +1,79 @@
+/*
+ * CLOUD PUBLISHER THREAD for lazy, rate-limited streaming of clouds
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __CLOUDPUBLISHER_H__
+#define __CLOUDPUBLISHER_H__
+
+// Includes
+#include <yarp/os/RateThread.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/BufferedPort.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+/**
+ * @brief The CloudPublisher class streams clouds out of a port at a limited rate. Callers only mark a new version of the cloud,
+ * and the thread serializes and writes the latest one on its next cycle, so intermediate versions are never serialized.
+ * Nothing is copied nor serialized while the port has no readers: a reader that connects gets the next version published.
+ */
+class CloudPublisher: public yarp::os::RateThread
+{
+protected:
+    yarp::os::BufferedPort<yarp::os::Bottle>    *port;
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr      latest;         // last version published, not written yet if pending
+    yarp::os::Stamp                             latestStamp;
+    bool                                        pending;
+    int                                         skipped;        // versions replaced before being written
+    yarp::os::Mutex                             mutex;          // protects the latest version
+    yarp::os::Mutex                             writeMutex;     // protects the port
+
+    bool write();
+
+public:
+    // CONSTRUCTOR
+    CloudPublisher(yarp::os::BufferedPort<yarp::os::Bottle> *_port, int period = 100);
+
+    // RUN
+    virtual void run();
+
+    /**
+     * @brief publish - Marks a new version of the cloud to be sent out. The cloud is copied, so the caller can keep on modifying it.
+     * If the port has no readers, it is neither copied nor kept.
+     * @param cloud - cloud to be sent.
+     * @param stamp - envelope to be sent with it.
+     */
+    void publish(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const yarp::os::Stamp &stamp);
+
+    /**
+     * @brief flush - Writes the pending version right away, for readers that need it before the next cycle
+     * (e.g. before being commanded to process it).
+     * @return true if a cloud was written.
+     */
+    bool flush();
+
+    /**
+     * @brief getSkipped - Returns the number of versions that were replaced by a newer one before being written.
+     */
+    int getSkipped();
+};
+
+#endif
+
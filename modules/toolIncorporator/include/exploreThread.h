@@ -0,0 +1,72 @@
+/*
+ * EXPLORATION WORKER THREAD for pipelined tool exploration
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __EXPLORETHREAD_H__
+#define __EXPLORETHREAD_H__
+
+// Includes
+#include <deque>
+
+#include <yarp/os/Thread.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Semaphore.h>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+class ToolIncorporator;
+
+/**
+ * @brief The ExploreThread class processes the views captured during tool exploration, so that the robot can move on to the next view meanwhile.
+ * Views are queued by the module once captured (already on the hand frame, with the hand pose at capture time), and fused here,
+ * one after the other, into the model being reconstructed.
+ */
+class ExploreThread: public yarp::os::Thread
+{
+protected:
+    ToolIncorporator                                        *module;
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr                  cloud_merged;      // Model being reconstructed. Not to be accessed from outside until done.
+
+    std::deque<pcl::PointCloud<pcl::PointXYZRGB>::Ptr>      views;
+    int                                                     pending;           // Views queued or being processed
+    yarp::os::Mutex                                         viewsMutex;
+    yarp::os::Semaphore                                     viewQueued;
+    yarp::os::Semaphore                                     viewDone;
+
+public:
+    // CONSTRUCTOR
+    ExploreThread(ToolIncorporator *_module, pcl::PointCloud<pcl::PointXYZRGB>::Ptr _cloud_merged);
+
+    // RUN
+    virtual void run();
+    virtual void onStop();
+
+    /**
+     * @brief addView - Queues a captured view to be fused into the model.
+     * @param view - Captured cloud, on the hand reference frame. Ownership passes to the thread.
+     */
+    void addView(pcl::PointCloud<pcl::PointXYZRGB>::Ptr view);
+
+    /**
+     * @brief waitDone - Blocks until all the queued views have been fused into the model.
+     */
+    void waitDone();
+};
+
+#endif
+
@@ -0,0 +1,124 @@
+/*
+ * JOB WORKER THREAD for asynchronous execution of long RPC commands
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __JOBTHREAD_H__
+#define __JOBTHREAD_H__
+
+// Includes
+#include <string>
+#include <map>
+
+#include <yarp/os/Thread.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Semaphore.h>
+#include <yarp/os/Bottle.h>
+
+class ToolIncorporator;
+
+/**
+ * @brief The JobThread class executes long RPC commands (jobs) in the background, one at a time,
+ * so that the module can keep answering other commands (status, queries, cancellation) meanwhile.
+ * Jobs are identified by an increasing id. The record of the last jobs is kept to be queried.
+ */
+class JobThread: public yarp::os::Thread
+{
+public:
+    enum JobState { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_FAILED, JOB_CANCELLED };
+
+    struct Job {
+        int                 id;
+        yarp::os::Bottle    command;
+        yarp::os::Bottle    reply;
+        JobState            state;
+        double              progress;       // 0 to 1
+        std::string         progressMsg;
+        double              tSubmit;
+        double              tStart;
+        double              tEnd;
+    };
+
+protected:
+    ToolIncorporator                *module;
+    std::map<int, Job>              jobs;
+    int                             nextId;
+    int                             currentId;      // job queued or running, -1 if idle
+    bool                            cancelFlag;
+    yarp::os::Mutex                 mutex;
+    yarp::os::Semaphore             jobReady;
+
+    static const int                maxRecords = 20;
+
+public:
+    // CONSTRUCTOR
+    JobThread(ToolIncorporator *_module);
+
+    // RUN
+    virtual void run();
+    virtual void onStop();
+
+    /**
+     * @brief submit - Queues a command to be executed in the background.
+     * @param command - RPC command, as it would be sent to the module.
+     * @return id of the job, or -1 if another job is still queued or running.
+     */
+    int submit(const yarp::os::Bottle &command);
+
+    /**
+     * @brief isBusy - Returns whether a job is queued or running.
+     */
+    bool isBusy();
+
+    /**
+     * @brief getJob - Returns a copy of the record of the job with the given id.
+     * @return false if there is no record of that job.
+     */
+    bool getJob(const int id, Job &job);
+
+    /**
+     * @brief wait - Blocks until the given job has finished, or timeout seconds have passed (0 to wait indefinitely).
+     * @return true if the job has finished.
+     */
+    bool wait(const int id, const double timeout = 0.0);
+
+    /**
+     * @brief cancel - Requests the cancellation of the given job. Cancellation is cooperative: long actions check
+     * isCancelled() at safe points and return early.
+     * @return false if the job is not queued or running.
+     */
+    bool cancel(const int id);
+
+    /**
+     * @brief isCancelled - Returns whether the running job has been asked to stop.
+     */
+    bool isCancelled();
+
+    /**
+     * @brief setProgress - Reports the progress of the running job.
+     * @param progress - Fraction of the job done (0 to 1).
+     * @param msg - Description of the current step.
+     */
+    void setProgress(const double progress, const std::string &msg);
+
+    /**
+     * @brief stateName - Returns the name of a job state, as reported by the status RPC.
+     */
+    static std::string stateName(const JobState state);
+};
+
+#endif
+
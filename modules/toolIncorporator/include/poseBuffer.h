@@ -0,0 +1,74 @@
+/*
+ * HAND POSE BUFFER for capture-time frame transformations
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __POSEBUFFER_H__
+#define __POSEBUFFER_H__
+
+// Includes
+#include <vector>
+#include <string>
+
+#include <yarp/os/RateThread.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/sig/Vector.h>
+#include <yarp/dev/CartesianControl.h>
+#include <yarp/dev/GazeControl.h>
+
+/**
+ * @brief The PoseBuffer class samples the pose of the controlled hand (or of one eye) at a fixed rate into a ring buffer,
+ * so that the pose at any recent instant (e.g. the capture time of a cloud) can be retrieved later on,
+ * regardless of the motion of the robot meanwhile.
+ */
+class PoseBuffer: public yarp::os::RateThread
+{
+protected:
+    struct PoseSample {
+        double              t;
+        yarp::sig::Vector   x;      // position
+        yarp::sig::Vector   o;      // orientation, in axis-angle
+    };
+
+    yarp::dev::ICartesianControl        *iCart;         // source of hand poses, NULL when sampling an eye
+    yarp::dev::IGazeControl             *iGaze;         // source of eye poses
+    std::string                         eye;            // "left" or "right"
+    std::vector<PoseSample>             samples;        // ring buffer
+    int                                 newest;         // index of the last sample written
+    int                                 count;          // number of valid samples
+    yarp::os::Mutex                     mutex;
+
+public:
+    // CONSTRUCTOR
+    PoseBuffer(yarp::dev::ICartesianControl *_iCart, int period = 10, int size = 200);
+    PoseBuffer(yarp::dev::IGazeControl *_iGaze, const std::string &_eye, int period = 10, int size = 200);
+
+    // RUN
+    virtual void run();
+
+    /**
+     * @brief getPoseAt - Returns the sampled pose at the given time, interpolating between the surrounding samples
+     * (linearly for the position, along the shortest rotation for the orientation).
+     * @param t - Time at which the pose is requested (same clock as yarp::os::Time and the port envelopes).
+     * @param x - Position at t.
+     * @param o - Orientation at t, in axis-angle.
+     * @return true if t is covered by the buffer (or is no older than one period past its last sample), false otherwise.
+     */
+    bool getPoseAt(const double t, yarp::sig::Vector &x, yarp::sig::Vector &o);
+};
+
+#endif
+
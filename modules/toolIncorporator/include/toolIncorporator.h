@@ -24,6 +24,8 @@
 #include <string>
 #include <algorithm>
 #include <numeric>
+#include <map>
+#include <vector>
 
 //YARP libs
 #include <yarp/os/all.h>
@@ -35,6 +37,9 @@
 #include <yarp/os/BufferedPort.h>
 
 #include "iCub/YarpCloud/CloudUtils.h" 
+#include "iCub/YarpCloud/CloudPipeline.h"
+
+#include "visualizerClient.h"
 
 //PCL libs
 #include <pcl/point_cloud.h>
@@ -64,9 +69,16 @@
 
 
 
+class PoseBuffer;
+class CloudPublisher;
+class JobThread;
+
 /**********************************************************/
 class ToolIncorporator : public yarp::os::RFModule
 {
+    friend class ExploreThread;
+    friend class JobThread;
+
 protected:
     /* variables */ 
     // ports
@@ -82,6 +94,7 @@ protected:
     yarp::os::RpcServer                 rpcPort;
     yarp::os::RpcClient         		rpcObjRecPort;          //rpc port to communicate with objectReconst module
     yarp::os::RpcClient         		rpcVisualizerPort;      //rpc port to communicate with tool3Dshow module to display pointcloud
+    VisualizerClient                    visualizer;             // queues drawing commands and sends them in one-way batches to show3D
     yarp::os::RpcClient         		rpcFeatExtPort;         //rpc port to communicate with the 3D feature extraction module
     yarp::os::RpcClient         		rpcClassifierPort;         //rpc port to communicate with the 3D feature extraction module
 
@@ -97,10 +110,69 @@ protected:
     yarp::dev::ICartesianControl        *iCartCtrlR;
     yarp::dev::ICartesianControl        *iCartCtrl;
     yarp::dev::ICartesianControl        *otherHandCtrl;
+    PoseBuffer                          *poseBuffer;        // recent hand poses, to transform clouds with the pose at capture time
+    PoseBuffer                          *eyePoseBuffer;     // recent poses of the camera eye, to draw on images with the poses at capture time
+    CloudPublisher                      *cloudPublisher;    // writes the latest cloud sent out on clouds:o, at a limited rate
+    JobThread                           *jobThrd;           // runs long commands in the background
+
+    // command table and per-command stats
+    // RPC commands, in the order of the command table. Job commands go last.
+    enum CommandId {
+        CMD_LOADCLOUD, CMD_SAVECLOUD, CMD_GET3D, CMD_FILTER, CMD_EXPLORETOOL,
+        CMD_TURNHAND, CMD_LOOKATTOOL, CMD_LOOKAROUND, CMD_CLEARTOOL, CMD_LEARN,
+        CMD_RECOG, CMD_FINDPOSEALIGN, CMD_SETPOSEPARAM, CMD_MAKECANON, CMD_ALIGNFROMFILES,
+        CMD_GETORI, CMD_GETDISP, CMD_GETTILT, CMD_GETSHIFT, CMD_CLEARPOSE,
+        CMD_FINDTOOLTIPCANON, CMD_FINDTOOLTIPPARAM, CMD_FINDTOOLTIPALIGN, CMD_FINDSYMS, CMD_FINDTOOLTIPSYM,
+        CMD_CLEARTIP, CMD_GETAFFORDANCE, CMD_EXTRACTFEATS, CMD_HANDFRAME, CMD_FPFH,
+        CMD_SETBB, CMD_ICP, CMD_NOISE, CMD_SHOWTIPPROJ, CMD_SEG2D,
+        CMD_SAVENAME, CMD_SAVING, CMD_FAST, CMD_VERBOSE, CMD_HELP,
+        CMD_QUIT, CMD_SUBMIT, CMD_STATUS, CMD_WAIT, CMD_CANCEL,
+        CMD_STATS,
+        CMD_NUM
+    };
+
+    struct CommandInfo {
+        int                 id;
+        std::string         name;
+        int                 minArgs;
+        int                 maxArgs;        // -1 for any
+        std::string         types;          // type of each argument: 's' string, 'i' integer, 'd' number, 'b' boolean, '?' any
+        bool                isLong;         // moves the robot or processes for long: can be submitted as a job
+        bool                changesModel;   // changes the model, pose or tooltip: not run while a job is busy
+    };
+
+    struct CommandStats {
+        static const int    numBuckets = 18;  // latency histogram: <1ms, [1,2)ms, [2,4)ms ... >=65s
+        int                 count;
+        int                 failures;
+        double              totalTime;
+        double              maxTime;
+        int                 hist[numBuckets];
+        CommandStats(): count(0), failures(0), totalTime(0.0), maxTime(0.0) { for (int b = 0; b < numBuckets; b++) hist[b] = 0; }
+    };
+
+    std::map<std::string, CommandInfo>  commands;
+    std::vector<std::string>            cmdNames;
+    std::vector<CommandStats>           cmdStats;
+    yarp::os::Mutex                     statsMutex;
+
+    // tool state as left by the last command, so that it can be queried while a job changes it
+    struct ToolState {
+        bool                                    cloudLoaded;
+        bool                                    poseFound;
+        std::string                             toolName;
+        yarp::sig::Matrix                       toolPose;
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr  cloud_pose;     // copy of the cloud in pose, not modified afterwards
+    };
+    ToolState                           published;
+    yarp::os::Mutex                     stateMutex;
+    static const double                 maxWaitTime;        // longest a 'wait' command may block the RPC port (s)
 
     // config variables
     std::string                         hand;
     std::string                         camera;
+    bool                                camIntrinsicsOK;    // whether the projection matrix of the camera is known
+    Eigen::Matrix<double,3,4,Eigen::DontAlign>  camPrj;     // intrinsic projection matrix of the camera, read once from the gaze controller
     std::string                         robot;    
     std::string                         cloudsPathFrom;
     std::string                         cloudsPathTo;
@@ -108,6 +180,12 @@ protected:
     bool                                saving;
     bool                                verbose;
     bool                                handFrame;
+    bool                                fast;               // does not wait for the visualizer when ON
+    double                              visTimeout;
+    double                              motionTimeout;
+    yarp::os::Stamp                     cloudStamp;         // numbers the clouds and drawing batches sent out
+    yarp::os::Mutex                     sendMutex;          // protects cloudStamp, so that clouds sent from the exploration thread are numbered in order
+    int                                 cloudVersion;       // last version given to a cloud kept by the visualizer
 
     // icp variables
     int                                 icp_maxIt;
@@ -115,10 +193,12 @@ protected:
     double                              icp_ranORT;
     double                              icp_transEp;
 
-    // mls variables
-    double                              mls_rad;
-    double                              mls_usRad;
-    double                              mls_usStep;
+    // cloud processing pipelines, configured from the ini file
+    iCub::YarpCloud::CloudPipeline      recPipe;            // cleans each partial reconstruction
+    iCub::YarpCloud::CloudPipeline      mergePipe;          // reduces the model merged during exploration
+    iCub::YarpCloud::CloudPipeline      explorePipe;        // cleans the final explored model
+    iCub::YarpCloud::CloudPipeline      filterPipe;         // filters loaded models
+    iCub::YarpCloud::CloudPipeline      symPipe;            // prepares models for symmetry estimation
 
     // noise params
     double                              noise_mean;
@@ -154,6 +234,21 @@ protected:
 
 
     /* functions*/
+
+    /* Command execution */
+    void                registerCommands();
+    void                addCommand(const std::string &name, const int id, const int minArgs, const int maxArgs, const std::string &types, const bool isLong, const bool changesModel);
+    bool                checkArgs(const CommandInfo &info, const yarp::os::Bottle &command, yarp::os::Bottle &reply);
+    void                recordStats(const int cmdId, const bool ok, const double time);
+    void                getStats(yarp::os::Bottle &statsB);
+    bool                execute(const yarp::os::Bottle &command, yarp::os::Bottle &reply);
+    bool                dispatch(const int cmdId, const yarp::os::Bottle &command, yarp::os::Bottle &reply);
+    bool                isLongCommand(const std::string &cmd);
+    bool                cancelled();
+    void                reportProgress(const double progress, const std::string &msg);
+    void                stopThreads();
+    void                publishState(const bool withClouds);
+    void                getState(ToolState &state);
     
     /* Actions */
     bool                turnHand(const int rotDegX = 0, const int rotDegY = 0, const bool followTool = false);
@@ -161,7 +256,9 @@ protected:
     bool                lookAtTool();
     bool                lookAtHand();
     bool                lookAround(const bool wait = true);
+    bool                waitArmStill(const double timeout = 3.0);
     double              adaptDepth(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, double spatial_distance);
+    bool                fuseView(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec_merged);
 
     /* Object info from Cloud */
     bool                loadCloud(const std::string &cloud_name, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud);
@@ -169,7 +266,13 @@ protected:
 
     bool                get2Dtooltip(bool get3D, yarp::sig::Vector &ttip2D);
     bool                getPointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec, double segParam = -1.0, double handRad = 0.06);
-    bool                sendPointCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud);
+    bool                capturePointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec, double segParam = -1.0, double handRad = 0.06);
+    bool                getCameraIntrinsics();
+    bool                projectToImage(const yarp::sig::Matrix &H, const yarp::sig::Vector &xe, const yarp::sig::Vector &oe, const Eigen::Matrix<double,4,Eigen::Dynamic> &pts, Eigen::Matrix<double,2,Eigen::Dynamic> &px);
+    int                 sendPointCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const std::string &visId = "", const int visVersion = 0);
+    bool                sendCloudUpdate(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const std::string &visId, const int visVersion, int color[], const Eigen::Matrix4f &pose);
+    bool                flushVisualizer();
+    void                waitDisplayed(const int seq);
 
     bool                findPoseAlign(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr modelCloud, pcl::PointCloud<pcl::PointXYZRGB>::Ptr poseCloud, yarp::sig::Matrix &pose, const int T = 5);
     bool                alignPointClouds(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_from, const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_to, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_aligned, Eigen::Matrix4f& transfMat, double fitScore);
@@ -189,7 +292,7 @@ protected:
 
 
     bool                extractFeats();
-    bool                getAffordances(yarp::os::Bottle &affBottle, bool allAffs = false);
+    bool                getAffordances(const ToolState &state, yarp::os::Bottle &affBottle, bool allAffs = false);
     int                 getTPindex(const std::string &tool, const yarp::sig::Matrix &pose);
     bool                getAffProps(const yarp::sig::Matrix &affMatrix, yarp::os::Property &affProps);
 
@@ -199,6 +302,7 @@ protected:
     bool                recognize(std::string &label);
 
     /* Cloud Utils */
+    bool                getHandTransform(Eigen::Matrix4f &R2H, const double t = -1.0);
     bool                frame2Hand(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_trans);
     bool                cloud2canonical(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_canon);
 
@@ -206,8 +310,7 @@ protected:
     bool                showRefFrame(const Point3D center, const std::vector<Plane3D> &refPlanes);
     bool                showLine(const Point3D coordsIni, const Point3D coordsEnd, int color[]);
 
-    bool                filterCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out, double thr = 3.0);
-    bool                smoothCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_smooth, double rad,double usRad, double usStep);
+    bool                filterCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_out);
     void                computeLocalFeatures(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, pcl::PointCloud<pcl::FPFHSignature33>::Ptr features);
     void                computeSurfaceNormals (const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, pcl::PointCloud<pcl::Normal>::Ptr normals);    
     int                 getSign(const double x);    
@@ -221,6 +324,7 @@ protected:
     bool                setBB(const bool depth);
     bool                setSeg(const std::string& seg);
     bool                setSaving(const std::string& sav);
+    bool                setFast(const std::string& fm);
     bool                changeSaveName(const std::string& fname);
        
 public:
@@ -0,0 +1,152 @@
+/*
+ * VISUALIZER CLIENT for batched, one-way drawing commands
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __VISUALIZERCLIENT_H__
+#define __VISUALIZERCLIENT_H__
+
+// Includes
+#include <string>
+#include <map>
+#include <vector>
+#include <deque>
+
+#include <yarp/os/Thread.h>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Semaphore.h>
+#include <yarp/os/PortReport.h>
+#include <yarp/os/PortInfo.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+/**
+ * @brief The VisualizerClient class queues drawing commands for the show3D module (clear, accumulate, cloud, sphere, arrow)
+ * and sends them together as a single one-way message on flush(), to be connected to /show3D/draw:i.
+ * Commands are applied by the visualizer in the order they were queued, clouds included, and nothing waits for a reply.
+ * Clouds are only copied when queued: they are serialized and written by the writer thread of the client, batch after batch,
+ * so that the caller does not wait for it. If the port is not connected, queued commands are discarded on flush.
+ * At most maxQueued batches wait to be written: if the visualizer falls behind, the oldest are dropped, but for their identified clouds.
+ */
+class VisualizerClient: public yarp::os::Thread
+{
+protected:
+    struct Batch {
+        yarp::os::Bottle                                        commands;   // 'cloud' commands hold an empty list, filled on write
+        std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr>     clouds;     // points of the 'cloud' commands, in order
+        yarp::os::Stamp                                         stamp;
+    };
+
+    yarp::os::BufferedPort<yarp::os::Bottle>    port;
+    Batch                                       batch;          // commands queued since the last flush
+    std::deque<Batch>                           outgoing;       // batches flushed, waiting to be written
+    std::map<std::string, int>                  sentVersions;   // version of each identified cloud the visualizer has
+    bool                                        reconnected;    // connections changed since sentVersions was last checked
+    yarp::os::Mutex                             mutex;
+    yarp::os::Semaphore                         batchReady;
+
+    static const size_t                         maxQueued = 4;
+
+    // Flags every connection and disconnection of the port, as a visualizer (re)connected does not have the clouds sent before
+    class ConnectionReporter: public yarp::os::PortReport {
+        VisualizerClient &client;
+    public:
+        ConnectionReporter(VisualizerClient &_client): client(_client) {}
+        virtual void report(const yarp::os::PortInfo &info);
+    };
+    ConnectionReporter                          reporter;
+    friend class ConnectionReporter;
+
+    void write(Batch &b);
+    void dropOldest();
+    void checkConnections();
+
+public:
+    // CONSTRUCTOR
+    VisualizerClient();
+
+    // RUN
+    virtual void run();
+    virtual void onStop();
+
+    /**
+     * @brief open - Opens the port and starts the writer thread.
+     */
+    bool open(const std::string &portName);
+    void interrupt();
+
+    /**
+     * @brief close - Stops the writer thread, discarding the batches not written yet, and closes the port.
+     */
+    void close();
+
+    /**
+     * @brief isConnected - Returns whether there is a visualizer connected to the port.
+     */
+    bool isConnected();
+
+    /**
+     * @brief clear - Queues the removal of all clouds and shapes from the display.
+     */
+    void clear();
+
+    /**
+     * @brief accumulate - Queues the selection between plotting the following clouds together (true) or replacing the last one (false).
+     */
+    void accumulate(const bool accum);
+
+    /**
+     * @brief addCloud - Queues a cloud to be displayed. It is copied, so the caller can keep on modifying it,
+     * and serialized (CloudUtils::cloud2bottle) by the writer thread straight into the message.
+     * @param id - (optional) identifies the cloud on the visualizer, which keeps it to apply later updates on.
+     * @param version - version of the cloud with that id. If the visualizer already has it, only a reference is sent.
+     */
+    void addCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const std::string &id = "", const int version = 0);
+
+    /**
+     * @brief updateCloud - Queues the display of a cloud previously sent with addCloud, recolored and transformed, without its points.
+     * @param id, version - cloud to display, as sent with addCloud.
+     * @param color - color (RGB) of the whole cloud.
+     * @param pose - transformation applied to the points as they were sent.
+     * @return false if the visualizer does not have that version of the cloud, which then has to be sent whole.
+     */
+    bool updateCloud(const std::string &id, const int version, const int color[], const Eigen::Matrix4f &pose);
+
+    /**
+     * @brief addSphere - Queues a sphere at the given coordinates, with the given color (RGB).
+     */
+    void addSphere(const double x, const double y, const double z, const int color[]);
+
+    /**
+     * @brief addArrow - Queues an arrow between the given coordinates, with the given color (RGB).
+     */
+    void addArrow(const double xIni, const double yIni, const double zIni,
+                  const double xEnd, const double yEnd, const double zEnd, const int color[]);
+
+    /**
+     * @brief flush - Hands all the queued commands to the writer thread, to be sent in one message, without waiting for them to be displayed.
+     * @param stamp - Envelope of the message, whose count can be passed to the visualizer's sync command to wait for its display.
+     * @return true if a message is to be sent, false if there was nothing to send or no visualizer connected.
+     */
+    bool flush(const yarp::os::Stamp &stamp);
+};
+
+#endif
+
@@ -0,0 +1,78 @@
+#include "cloudPublisher.h"
+
+#include "iCub/YarpCloud/CloudUtils.h"
+
+using namespace std;
+using namespace yarp::os;
+using namespace iCub::YarpCloud;
+
+// Constructor
+CloudPublisher::CloudPublisher(BufferedPort<Bottle> *_port, int period):
+    RateThread(period), port(_port), pending(false), skipped(0) {}
+
+// Write the latest version, if there is a new one and anyone to read it
+void CloudPublisher::run()
+{
+    write();
+}
+
+void CloudPublisher::publish(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const Stamp &stamp)
+{
+    if (port->getOutputCount() == 0){
+        mutex.lock();
+        latest.reset();
+        pending = false;
+        mutex.unlock();
+        return;
+    }
+
+    // Copy outside the lock, and only swap the pointer in, so the writer is never kept waiting by the copy.
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr copy (new pcl::PointCloud<pcl::PointXYZRGB> (*cloud));
+
+    mutex.lock();
+    if (pending)
+        skipped++;
+    latest = copy;
+    latestStamp = stamp;
+    pending = true;
+    mutex.unlock();
+}
+
+bool CloudPublisher::flush()
+{
+    return write();
+}
+
+int CloudPublisher::getSkipped()
+{
+    mutex.lock();
+    int n = skipped;
+    mutex.unlock();
+    return n;
+}
+
+bool CloudPublisher::write()
+{
+    // Serialized writers (thread cycle and flush), so that the port buffer is prepared by one at a time
+    writeMutex.lock();
+    mutex.lock();
+    if ((!pending) || (port->getOutputCount() == 0)){
+        mutex.unlock();
+        writeMutex.unlock();
+        return false;
+    }
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = latest;
+    Stamp stamp = latestStamp;
+    pending = false;
+    mutex.unlock();
+
+    // The cloud is not modified after publish(), so it can be serialized without the lock.
+    Bottle &cloudBottleOut = port->prepare();
+    cloudBottleOut.clear();
+    CloudUtils::cloud2bottle(cloud, cloudBottleOut);
+    port->setEnvelope(stamp);
+    port->writeStrict();
+    writeMutex.unlock();
+
+    return true;
+}
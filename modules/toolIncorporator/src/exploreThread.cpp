@@ -0,0 +1,66 @@
+#include "exploreThread.h"
+#include "toolIncorporator.h"
+
+using namespace std;
+using namespace yarp::os;
+
+// Constructor
+ExploreThread::ExploreThread(ToolIncorporator *_module, pcl::PointCloud<pcl::PointXYZRGB>::Ptr _cloud_merged):
+    module(_module), cloud_merged(_cloud_merged), pending(0), viewQueued(0), viewDone(0) {}
+
+// Process queued views until stopped
+void ExploreThread::run()
+{
+    while (!isStopping())
+    {
+        viewQueued.wait();
+        if (isStopping())
+            break;
+
+        viewsMutex.lock();
+        if (views.empty()){         // woken up by onStop, or with nothing left
+            viewsMutex.unlock();
+            continue;
+        }
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr view = views.front();
+        views.pop_front();
+        viewsMutex.unlock();
+
+        module->fuseView(view, cloud_merged);
+
+        viewsMutex.lock();
+        pending--;
+        viewsMutex.unlock();
+        viewDone.post();
+    }
+}
+
+// Unblock the thread so it can be stopped
+void ExploreThread::onStop()
+{
+    viewQueued.post();
+}
+
+// Queue a new view
+void ExploreThread::addView(pcl::PointCloud<pcl::PointXYZRGB>::Ptr view)
+{
+    viewsMutex.lock();
+    views.push_back(view);
+    pending++;
+    viewsMutex.unlock();
+    viewQueued.post();
+}
+
+// Wait for all the queued views to be processed
+void ExploreThread::waitDone()
+{
+    while (true)
+    {
+        viewsMutex.lock();
+        int left = pending;
+        viewsMutex.unlock();
+        if (left == 0)
+            return;
+        viewDone.wait();
+    }
+}
@@ -0,0 +1,177 @@
+#include "jobThread.h"
+#include "toolIncorporator.h"
+
+#include <yarp/os/Time.h>
+
+using namespace std;
+using namespace yarp::os;
+
+// Constructor
+JobThread::JobThread(ToolIncorporator *_module):
+    module(_module), nextId(1), currentId(-1), cancelFlag(false), jobReady(0) {}
+
+// Execute jobs as they are submitted
+void JobThread::run()
+{
+    while (!isStopping())
+    {
+        jobReady.wait();
+        if (isStopping())
+            break;
+
+        mutex.lock();
+        int id = currentId;
+        Job &job = jobs[id];
+        if (cancelFlag){
+            // Cancelled before it started
+            job.state = JOB_CANCELLED;
+            job.tStart = job.tEnd = Time::now();
+            currentId = -1;
+            cancelFlag = false;
+            mutex.unlock();
+            continue;
+        }
+        job.state = JOB_RUNNING;
+        job.tStart = Time::now();
+        Bottle command = job.command;
+        mutex.unlock();
+
+        cout << "Running job " << id << ": " << command.toString() << endl;
+        Bottle reply;
+        bool ok = module->execute(command, reply);
+
+        mutex.lock();
+        Job &jobDone = jobs[id];
+        jobDone.reply = reply;
+        jobDone.tEnd = Time::now();
+        if (cancelFlag){
+            jobDone.state = JOB_CANCELLED;
+        }else if (ok){
+            jobDone.state = JOB_DONE;
+            jobDone.progress = 1.0;
+        }else{
+            jobDone.state = JOB_FAILED;
+        }
+        currentId = -1;
+        cancelFlag = false;
+
+        // Keep only the record of the last jobs
+        while (jobs.size() > (size_t)maxRecords)
+            jobs.erase(jobs.begin());
+        mutex.unlock();
+
+        cout << "Job " << id << " finished (" << stateName(jobDone.state) << ") in " << jobDone.tEnd - jobDone.tStart << " s." << endl;
+    }
+}
+
+// Unblock the thread so it can be stopped
+void JobThread::onStop()
+{
+    mutex.lock();
+    cancelFlag = true;
+    mutex.unlock();
+    jobReady.post();
+}
+
+// Queue a new job
+int JobThread::submit(const Bottle &command)
+{
+    mutex.lock();
+    if (currentId >= 0){
+        mutex.unlock();
+        return -1;
+    }
+
+    Job job;
+    job.id = nextId++;
+    job.command = command;
+    job.state = JOB_QUEUED;
+    job.progress = 0.0;
+    job.progressMsg = "queued";
+    job.tSubmit = Time::now();
+    job.tStart = 0.0;
+    job.tEnd = 0.0;
+    jobs[job.id] = job;
+    currentId = job.id;
+    cancelFlag = false;
+    mutex.unlock();
+
+    jobReady.post();
+    return job.id;
+}
+
+bool JobThread::isBusy()
+{
+    mutex.lock();
+    bool busy = currentId >= 0;
+    mutex.unlock();
+    return busy;
+}
+
+bool JobThread::getJob(const int id, Job &job)
+{
+    mutex.lock();
+    map<int, Job>::iterator it = jobs.find(id);
+    bool found = it != jobs.end();
+    if (found)
+        job = it->second;
+    mutex.unlock();
+    return found;
+}
+
+bool JobThread::wait(const int id, const double timeout)
+{
+    double t0 = Time::now();
+    while (true)
+    {
+        Job job;
+        if (!getJob(id, job))
+            return false;
+        if ((job.state != JOB_QUEUED) && (job.state != JOB_RUNNING))
+            return true;
+        if ((timeout > 0.0) && (Time::now() - t0 > timeout))
+            return false;
+        Time::delay(0.05);
+    }
+}
+
+bool JobThread::cancel(const int id)
+{
+    mutex.lock();
+    bool ok = (id == currentId);
+    if (ok)
+        cancelFlag = true;
+    mutex.unlock();
+    return ok;
+}
+
+bool JobThread::isCancelled()
+{
+    mutex.lock();
+    bool cancelled = cancelFlag;
+    mutex.unlock();
+    return cancelled;
+}
+
+void JobThread::setProgress(const double progress, const string &msg)
+{
+    mutex.lock();
+    if (currentId >= 0){
+        jobs[currentId].progress = progress;
+        jobs[currentId].progressMsg = msg;
+    }
+    mutex.unlock();
+}
+
+string JobThread::stateName(const JobState state)
+{
+    switch (state)
+    {
+    case JOB_QUEUED:        return "queued";
+    case JOB_RUNNING:       return "running";
+    case JOB_DONE:          return "done";
+    case JOB_FAILED:        return "failed";
+    case JOB_CANCELLED:     return "cancelled";
+    }
+    return "unknown";
+}
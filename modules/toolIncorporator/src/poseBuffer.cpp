@@ -0,0 +1,102 @@
+#include "poseBuffer.h"
+
+#include <algorithm>
+
+#include <yarp/os/Time.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/math/Math.h>
+
+using namespace std;
+using namespace yarp::os;
+using namespace yarp::sig;
+using namespace yarp::dev;
+using namespace yarp::math;
+
+// Constructors. The buffer keeps at least one sample.
+PoseBuffer::PoseBuffer(ICartesianControl *_iCart, int period, int size):
+    RateThread(period), iCart(_iCart), iGaze(NULL), samples(max(size, 1)), newest(-1), count(0) {}
+
+PoseBuffer::PoseBuffer(IGazeControl *_iGaze, const string &_eye, int period, int size):
+    RateThread(period), iCart(NULL), iGaze(_iGaze), eye(_eye), samples(max(size, 1)), newest(-1), count(0) {}
+
+// Sample the current hand (or eye) pose
+void PoseBuffer::run()
+{
+    Vector x, o;
+    Stamp stamp;
+    bool ok;
+    if (iCart != NULL)
+        ok = iCart->getPose(x, o, &stamp);
+    else
+        ok = (eye == "left") ? iGaze->getLeftEyePose(x, o, &stamp) : iGaze->getRightEyePose(x, o, &stamp);
+    if (!ok)
+        return;
+
+    // Use the time at which the controller computed the pose, when available
+    double t = stamp.isValid() ? stamp.getTime() : Time::now();
+
+    mutex.lock();
+    int next = (newest + 1) % samples.size();
+    samples[next].t = t;
+    samples[next].x = x;
+    samples[next].o = o;
+    newest = next;
+    if (count < (int)samples.size())
+        count++;
+    mutex.unlock();
+}
+
+// Interpolate the pose at time t
+bool PoseBuffer::getPoseAt(const double t, Vector &x, Vector &o)
+{
+    mutex.lock();
+    if (count == 0){
+        mutex.unlock();
+        return false;
+    }
+
+    int size = samples.size();
+    int oldest = (newest - count + 1 + size) % size;
+
+    // Requested after the last sample: only accept it if the next sample would not have been taken yet
+    if (t >= samples[newest].t){
+        bool ok = (t - samples[newest].t) <= getRate()/1000.0;
+        if (ok){
+            x = samples[newest].x;
+            o = samples[newest].o;
+        }
+        mutex.unlock();
+        return ok;
+    }
+
+    if (t < samples[oldest].t){
+        mutex.unlock();
+        return false;
+    }
+
+    // Look for the samples surrounding t, from the newest backwards
+    int i1 = newest;
+    int i0 = (i1 - 1 + size) % size;
+    while (samples[i0].t > t){
+        i1 = i0;
+        i0 = (i0 - 1 + size) % size;
+    }
+    PoseSample s0 = samples[i0];
+    PoseSample s1 = samples[i1];
+    mutex.unlock();
+
+    double dt = s1.t - s0.t;
+    double alpha = (dt > 0.0) ? (t - s0.t)/dt : 0.0;
+
+    // Position: linear interpolation
+    x = s0.x + alpha*(s1.x - s0.x);
+
+    // Orientation: rotate from s0 a fraction alpha of the relative rotation towards s1
+    Matrix R0 = axis2dcm(s0.o);
+    Matrix R1 = axis2dcm(s1.o);
+    Vector dAxis = dcm2axis(R0.transposed()*R1);
+    dAxis[3] *= alpha;
+    o = dcm2axis(R0*axis2dcm(dAxis));
+
+    return true;
+}
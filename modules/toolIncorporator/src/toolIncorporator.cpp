@@ -16,6 +16,10 @@
 */
 
 #include "toolIncorporator.h"
+#include "exploreThread.h"
+#include "poseBuffer.h"
+#include "cloudPublisher.h"
+#include "jobThread.h"
 
 using namespace std;
 using namespace yarp::os;
@@ -33,6 +37,8 @@ using namespace iCub::YarpCloud;
 // - Performs pose estimation from model using alignment.
 // - Computes tool's intrinsic reference frame for intrinsic pose and tooltip estimation
 // - Computes tooltip from model and estimated pose.
+
+const double ToolIncorporator::maxWaitTime = 5.0;
   
 /**********************************************************
                     PUBLIC METHODS
@@ -82,8 +88,23 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
     seg2D = rf.check("seg2D", Value(false)).asBool();                   // Sets whether segmentation would be doen in 2D (true) or 3D (false)
     saving = rf.check("saving", Value(true)).asBool();                  // Sets whether recorded pointlcouds are saved or not.
     saveName = rf.check("saveName", Value("cloud")).asString();         // Sets the root name to save recorded clouds
+    fast = rf.check("fast", Value(false)).asBool();                     // Sets whether to skip waiting for the visualizer to display each cloud
+    visTimeout = rf.check("visTimeout", Value(2.0)).asDouble();         // Max time to wait for the visualizer to display a cloud (s)
+    motionTimeout = rf.check("motionTimeout", Value(10.0)).asDouble();  // Max time to wait for arm and gaze motions to finish (s)
+    int poseBufferPeriod = rf.check("poseBufferPeriod", Value(10)).asInt();       // hand pose sampling period (ms)
+    int poseBufferSize = rf.check("poseBufferSize", Value(300)).asInt();          // number of hand poses kept
+    if ((poseBufferPeriod <= 0) || (poseBufferSize <= 0)){
+        printf("\nposeBufferPeriod and poseBufferSize have to be positive\n");
+        return false;
+    }
 
     // Flow control variables
+    poseBuffer = NULL;
+    eyePoseBuffer = NULL;
+    cloudPublisher = NULL;
+    cloudVersion = 0;
+    camIntrinsicsOK = false;
+    jobThrd = NULL;
     initAlignment = false;
     displayTooltip = true;
     closing = false;
@@ -107,9 +128,18 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
     icp_ranORT = 0.05;
     icp_transEp = 0.0001;
 
-    mls_rad = 0.02;
-    mls_usRad = 0.01;
-    mls_usStep = 0.003;
+    // Cloud processing pipelines. Defaults are used for those not defined on the ini file.
+    recPipe.setVerbose(verbose);
+    recPipe.configure(rf, "pipe_rec", "(stages (sor)) (sor (meanK 10) (stdMul 3.0))");
+    mergePipe.setVerbose(verbose);
+    mergePipe.configure(rf, "pipe_merge", "(stages (ds)) (ds (res 0.002))");
+    explorePipe.setVerbose(verbose);
+    explorePipe.configure(rf, "pipe_explore", "(stages (rorFine ror sor)) (rorFine (type ror) (radius 0.01) (minNeigh 20) (passes 3)) (ror (radius 0.05) (minNeigh 50)) (sor (meanK 10) (stdMul 3.0))");
+    filterPipe.setVerbose(verbose);
+    filterPipe.configure(rf, "pipe_filter", "(stages (ror sor)) (ror (radius 0.05) (minNeigh 50)) (sor (meanK 10) (stdMul 3.0))");
+    symPipe.setVerbose(verbose);
+    symPipe.configure(rf, "pipe_sym", "(stages (ror sor dsIn mls dsOut)) (ror (radius 0.05) (minNeigh 50)) (sor (meanK 10) (stdMul 1.0)) "
+                                      "(dsIn (type ds) (res 0.005)) (mls (radius 0.02) (usRad 0.01) (usStep 0.003) (maxPoints 100000)) (dsOut (type ds) (res 0.005))");
 
     // Noise generation variables
     noise_mean = 0.0;
@@ -138,15 +168,41 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
         return false;
     }
 
+    // Clouds sent out are serialized and written by the publisher, only the latest one and only if anyone is reading
+    int publishPeriod = rf.check("publishPeriod", Value(100)).asInt();            // minimum period between clouds written (ms)
+    cloudPublisher = new CloudPublisher(&cloudsOutPort, publishPeriod);
+    if (!cloudPublisher->start()){
+        printf("\nProblems starting the cloud publisher\n");
+        delete cloudPublisher;
+        cloudPublisher = NULL;
+        return false;
+    }
+
     // RPC ports
     bool retRPC = true;
     retRPC = rpcPort.open(("/"+name+"/rpc:i").c_str());
     retRPC = retRPC && rpcObjRecPort.open(("/"+name+"/objrec:rpc").c_str());             // port to communicate with object reconstruction module
     retRPC = retRPC && rpcFeatExtPort.open(("/"+name+"/featExt:rpc").c_str());           // port to command the pointcloud feature extraction module
     retRPC = retRPC && rpcVisualizerPort.open(("/"+name+"/visualizer:rpc").c_str());     // port to command the visualizer module
+    retRPC = retRPC && visualizer.open("/"+name+"/visualizer:o");                         // port to send batches of drawing commands to the visualizer
     retRPC = retRPC && rpcClassifierPort.open(("/"+name+"/toolClass:rpc").c_str());     // port to command the classifier module
     if (!retRPC){
         printf("\nProblems opening RPC ports\n");
+        stopThreads();
+        return false;
+    }
+
+    // RPC command table
+    registerCommands();
+    publishState(true);
+
+    // Long commands can be run in the background as jobs, while the module keeps answering
+    jobThrd = new JobThread(this);
+    if (!jobThrd->start()){
+        printf("\nProblems starting the job thread\n");
+        delete jobThrd;
+        jobThrd = NULL;
+        stopThreads();
         return false;
     }
 
@@ -176,16 +232,21 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
     optionHR.put("local",("/"+name+"/hand_ctrl/right_arm").c_str());
 
     if (!driverG.open(optionG))
+    {
+        stopThreads();
         return false;
+    }
 
     if (!driverL.open(optionL))
     {
+        stopThreads();
         driverG.close();
         return false;
     }
 
     if (!driverR.open(optionR))
     {
+        stopThreads();
         driverG.close();
         driverL.close();
         return false;
@@ -193,6 +254,7 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
 
     if (!driverHL.open(optionHL))
     {
+        stopThreads();
         driverG.close();
         driverL.close();
         driverR.close();
@@ -201,6 +263,7 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
 
     if (!driverHR.open(optionHR))
     {
+        stopThreads();
         driverG.close();
         driverL.close();
         driverR.close();
@@ -218,8 +281,30 @@ bool ToolIncorporator::configure(ResourceFinder &rf)
     else if (hand=="right"){
         iCartCtrl=iCartCtrlR;
         otherHandCtrl=iCartCtrlL;}
-    else
+    else{
+        stopThreads();
         return false;
+    }
+
+    // Sample the hand pose continuously, so that clouds can be transformed with the pose at the time they were captured
+    poseBuffer = new PoseBuffer(iCartCtrl, poseBufferPeriod, poseBufferSize);
+    if (!poseBuffer->start()){
+        cout << "Could not start the hand pose buffer, poses will be read at processing time." << endl;
+        delete poseBuffer;
+        poseBuffer = NULL;
+    }
+
+    // The same for the eye of the camera, so that the overlay is drawn with both poses at the time the image was taken
+    eyePoseBuffer = new PoseBuffer(iGaze, camera, poseBufferPeriod, poseBufferSize);
+    if (!eyePoseBuffer->start()){
+        cout << "Could not start the eye pose buffer, the overlay will use the current poses." << endl;
+        delete eyePoseBuffer;
+        eyePoseBuffer = NULL;
+    }
+
+    // The overlay projects points locally, with the camera intrinsics read only once
+    if (!getCameraIntrinsics())
+        cout << "Camera intrinsics not available from the gaze controller, the overlay will query each pixel." << endl;
 
     iGaze->setSaccadesMode(false);
     if (robot == "icubSim"){
@@ -246,12 +331,10 @@ bool ToolIncorporator::interruptModule()
     iCartCtrlL->stopControl();
     iCartCtrlR->stopControl();
 
-    IVelocityControl *ivel;
-    if (hand=="left")
-        driverHL.view(ivel);
-    else
-        driverHR.view(ivel);
-    ivel->stop(4);
+    IVelocityControl *ivel = NULL;
+    bool viewOK = (hand=="left") ? driverHL.view(ivel) : driverHR.view(ivel);
+    if (viewOK && (ivel != NULL))
+        ivel->stop(4);
 
     imgInPort.interrupt();
     imgOutPort.interrupt();
@@ -261,6 +344,7 @@ bool ToolIncorporator::interruptModule()
     rpcPort.interrupt();
     rpcObjRecPort.interrupt();
     rpcVisualizerPort.interrupt();
+    visualizer.interrupt();
     rpcFeatExtPort.interrupt();
 
     return true;
@@ -269,6 +353,9 @@ bool ToolIncorporator::interruptModule()
 /************************************************************************/
 bool ToolIncorporator::close()
 {
+    // Threads first, so that no job is left using the ports or the publisher closed below
+    stopThreads();
+
     imgInPort.close();
     imgOutPort.close();
     cloudsInPort.close();
@@ -277,9 +364,9 @@ bool ToolIncorporator::close()
     rpcPort.close();
     rpcObjRecPort.close();
     rpcVisualizerPort.close();
+    visualizer.close();
     rpcFeatExtPort.close();
 
-
     driverG.close();
     driverL.close();
     driverR.close();
@@ -288,6 +375,36 @@ bool ToolIncorporator::close()
     return true;
 }
 
+/************************************************************************/
+void ToolIncorporator::stopThreads()
+{
+    // The job goes first, as it may still be sending clouds (stopping waits for it to finish, and every job
+    // stops its own exploration thread before returning). Then the threads it used.
+    if (jobThrd != NULL){
+        jobThrd->stop();
+        delete jobThrd;
+        jobThrd = NULL;
+    }
+
+    if (cloudPublisher != NULL){
+        cloudPublisher->stop();
+        delete cloudPublisher;
+        cloudPublisher = NULL;
+    }
+    visualizer.stop();
+
+    if (poseBuffer != NULL){
+        poseBuffer->stop();
+        delete poseBuffer;
+        poseBuffer = NULL;
+    }
+    if (eyePoseBuffer != NULL){
+        eyePoseBuffer->stop();
+        delete eyePoseBuffer;
+        eyePoseBuffer = NULL;
+    }
+}
+
 /************************************************************************/
 double ToolIncorporator::getPeriod()
 {
@@ -299,69 +416,89 @@ bool ToolIncorporator::updateModule()
 {
     if (imgOutPort.getOutputCount()>0)
     {        
+        // The image sent is the input buffer itself, so the previous one has to be sent before the buffer is read again
+        imgOutPort.waitForWrite();
+
         //if (ImageOf<PixelBgr> *pImgBgrIn=imgInPort.read(false))
         if (pImgBgrIn=imgInPort.read(false))
         {        
             imgW = pImgBgrIn->width();
             imgH = pImgBgrIn->height();
 
-            // Find and display endeffector with reference frame
-            Vector xa,oa;
-            iCartCtrl->getPose(xa,oa);
+            // Find and display endeffector with reference frame. The hand and eye poses are both taken at the time
+            // the image was taken if buffered, or both at the current time otherwise, so that they match while the head moves.
+            // The gaze controller can only project from the current pose.
+            Vector xa,oa,xe,oe;
+            Stamp imgStamp;
+            imgInPort.getEnvelope(imgStamp);
+            bool atCapture = camIntrinsicsOK && imgStamp.isValid() && (poseBuffer != NULL) && (eyePoseBuffer != NULL)
+                             && poseBuffer->getPoseAt(imgStamp.getTime(), xa, oa) && eyePoseBuffer->getPoseAt(imgStamp.getTime(), xe, oe);
+            bool eyeOK = atCapture;
+            if (!atCapture){
+                iCartCtrl->getPose(xa,oa);
+                eyeOK = (camera == "left") ? iGaze->getLeftEyePose(xe, oe) : iGaze->getRightEyePose(xe, oe);
+            }
 
             Matrix Ha=axis2dcm(oa);
             xa.push_back(1.0);
             Ha.setCol(3,xa);
 
-            Vector v(4,0.0); v[3]=1.0;
-            Vector c=Ha*v;
-
-            v=0.0; v[0]=0.05; v[3]=1.0;
-            Vector x=Ha*v;
-
-            v=0.0; v[1]=0.05; v[3]=1.0;
-            Vector y=Ha*v;
-
-            v=0.0; v[2]=0.05; v[3]=1.0;
-            Vector z=Ha*v;
-
-
-            Vector pc,px,py,pz,pt;
-            int camSel=(camera=="left")?0:1;
-            iGaze->get2DPixel(camSel,c,pc);
-            iGaze->get2DPixel(camSel,x,px);
-            iGaze->get2DPixel(camSel,y,py);
-            iGaze->get2DPixel(camSel,z,pz);
+            // Overlay points on the hand frame: origin, axes ends and tooltip
+            Eigen::Matrix<double,4,Eigen::Dynamic> ptsHand = Eigen::Matrix<double,4,Eigen::Dynamic>::Zero(4,5);
+            ptsHand.row(3).setOnes();
+            ptsHand(0,1) = 0.05;
+            ptsHand(1,2) = 0.05;
+            ptsHand(2,3) = 0.05;
+            ptsHand(0,4) = tooltip.x;   ptsHand(1,4) = tooltip.y;   ptsHand(2,4) = tooltip.z;
+            int numPts = displayTooltip ? 5 : 4;
+
+            Eigen::Matrix<double,2,Eigen::Dynamic> px;
+            if ((!eyeOK) || (!projectToImage(Ha, xe, oe, ptsHand.leftCols(numPts), px))){
+                // Fall back on the gaze controller, one call per point
+                px.resize(2, numPts);
+                int camSel=(camera=="left")?0:1;
+                for (int i = 0; i < numPts; i++){
+                    Vector v(4), p;
+                    for (int r = 0; r < 4; r++)
+                        v[r] = ptsHand(r,i);
+                    iGaze->get2DPixel(camSel,Ha*v,p);
+                    px(0,i) = p[0];
+                    px(1,i) = p[1];
+                }
+            }
 
-            cv::Point point_c = cvPoint((int)pc[0],(int)pc[1]);
-            cv::Point point_x = cvPoint((int)px[0],(int)px[1]);
-            cv::Point point_y = cvPoint((int)py[0],(int)py[1]);
-            cv::Point point_z = cvPoint((int)pz[0],(int)pz[1]);
+            cv::Point point_c = cvPoint((int)px(0,0),(int)px(1,0));
+            cv::Point point_x = cvPoint((int)px(0,1),(int)px(1,1));
+            cv::Point point_y = cvPoint((int)px(0,2),(int)px(1,2));
+            cv::Point point_z = cvPoint((int)px(0,3),(int)px(1,3));
 
             cvCircle(pImgBgrIn->getIplImage(),point_c,4,cvScalar(0,255,0),4);
             cvLine(pImgBgrIn->getIplImage(),point_c,point_x,cvScalar(0,0,255),2);
             cvLine(pImgBgrIn->getIplImage(),point_c,point_y,cvScalar(0,255,0),2);
             cvLine(pImgBgrIn->getIplImage(),point_c,point_z,cvScalar(255,0,0),2);
 
-            handFrame2D.u = pc[0];
-            handFrame2D.v = pc[1];
+            handFrame2D.u = px(0,0);
+            handFrame2D.v = px(1,0);
             // Display tooltip
             if (displayTooltip) {
-                v[0] = tooltip.x;   v[1] = tooltip.y;   v[2] = tooltip.z;   v[3] = 1.0;
-                Vector t=Ha*v;
-                iGaze->get2DPixel(camSel,t,pt);
-                cv::Point point_t = cvPoint((int)pt[0],(int)pt[1]);
+                cv::Point point_t = cvPoint((int)px(0,4),(int)px(1,4));
                 cvCircle(pImgBgrIn->getIplImage(),point_t,4,cvScalar(255,0,0),4);
                 cvLine(pImgBgrIn->getIplImage(),point_c,point_t,cvScalar(255,255,255),2);
 
-                tooltip2D.u = pt[0];
-                tooltip2D.v = pt[1];
+                tooltip2D.u = px(0,4);
+                tooltip2D.v = px(1,4);
 
             }else{
                 tooltip2D = handFrame2D;
             }
 
-            imgOutPort.prepare()=*pImgBgrIn;
+            // Send the drawn input buffer as it is, without copying the frame, unless its rows are padded
+            ImageOf<PixelBgr> &imgOut = imgOutPort.prepare();
+            if (pImgBgrIn->getRowSize() == imgW*3)
+                imgOut.setExternal(pImgBgrIn->getRawImage(), imgW, imgH);
+            else
+                imgOut.copy(*pImgBgrIn);
+            imgOutPort.setEnvelope(imgStamp);
             imgOutPort.write();
         }
     }
@@ -369,6 +506,152 @@ bool ToolIncorporator::updateModule()
     return !closing;
 }
 
+/************************************************************************/
+void ToolIncorporator::registerCommands()
+{
+    // RPC commands: name, minimum and maximum number of arguments (-1 for any), argument types, whether they are long,
+    // and whether they change the tool model, pose or tooltip (which jobs change too). Queries are answered from the published state.
+    // Types: 's' string, 'i' integer, 'd' number, 'b' boolean, '?' any.
+    addCommand("loadCloud",           CMD_LOADCLOUD,           1,  1, "s",     false, true);
+    addCommand("saveCloud",           CMD_SAVECLOUD,           0,  1, "s",     false, false);
+    addCommand("get3D",               CMD_GET3D,               0,  0, "",      true,  false);
+    addCommand("filter",              CMD_FILTER,              0,  0, "",      true,  false);
+    addCommand("exploreTool",         CMD_EXPLORETOOL,         1,  2, "ss",    true,  false);
+    addCommand("turnHand",            CMD_TURNHAND,            0,  3, "iib",   true,  false);
+    addCommand("lookAtTool",          CMD_LOOKATTOOL,          0,  0, "",      true,  false);
+    addCommand("lookAround",          CMD_LOOKAROUND,          0,  1, "b",     true,  false);
+    addCommand("cleartool",           CMD_CLEARTOOL,           0,  0, "",      false, true);
+    addCommand("learn",               CMD_LEARN,               1,  1, "s",     true,  false);
+    addCommand("recog",               CMD_RECOG,               0,  0, "",      true,  false);
+    addCommand("findPoseAlign",       CMD_FINDPOSEALIGN,       0,  1, "d",     true,  false);
+    addCommand("setPoseParam",        CMD_SETPOSEPARAM,        0,  4, "dddd",  false, true);
+    addCommand("makecanon",           CMD_MAKECANON,           0,  0, "",      true,  false);
+    addCommand("alignFromFiles",      CMD_ALIGNFROMFILES,      2,  2, "ss",    true,  false);
+    addCommand("getOri",              CMD_GETORI,              0,  0, "",      false, false);
+    addCommand("getDisp",             CMD_GETDISP,             0,  0, "",      false, false);
+    addCommand("getTilt",             CMD_GETTILT,             0,  0, "",      false, false);
+    addCommand("getShift",            CMD_GETSHIFT,            0,  0, "",      false, false);
+    addCommand("clearpose",           CMD_CLEARPOSE,           0,  0, "",      false, true);
+    addCommand("findTooltipCanon",    CMD_FINDTOOLTIPCANON,    0,  0, "",      true,  false);
+    addCommand("findTooltipParam",    CMD_FINDTOOLTIPPARAM,    0,  4, "dddd",  true,  false);
+    addCommand("findTooltipAlign",    CMD_FINDTOOLTIPALIGN,    0,  1, "i",     true,  false);
+    addCommand("findSyms",            CMD_FINDSYMS,            0,  0, "",      true,  false);
+    addCommand("findTooltipSym",      CMD_FINDTOOLTIPSYM,      0,  1, "d",     true,  false);
+    addCommand("cleartip",            CMD_CLEARTIP,            0,  0, "",      false, true);
+    addCommand("getAffordance",       CMD_GETAFFORDANCE,       0,  1, "b",     false, false);
+    addCommand("extractFeats",        CMD_EXTRACTFEATS,        0,  0, "",      true,  false);
+    addCommand("handFrame",           CMD_HANDFRAME,           1,  1, "s",     false, false);
+    addCommand("FPFH",                CMD_FPFH,                1,  1, "s",     false, false);
+    addCommand("setbb",               CMD_SETBB,               0,  1, "b",     false, false);
+    addCommand("icp",                 CMD_ICP,                 4,  4, "iddd",  false, false);
+    addCommand("noise",               CMD_NOISE,               2,  2, "dd",    false, false);
+    addCommand("showTipProj",         CMD_SHOWTIPPROJ,         1,  1, "s",     false, false);
+    addCommand("seg2D",               CMD_SEG2D,               1,  1, "s",     false, false);
+    addCommand("savename",            CMD_SAVENAME,            0,  1, "s",     false, false);
+    addCommand("saving",              CMD_SAVING,              1,  1, "s",     false, false);
+    addCommand("fast",                CMD_FAST,                1,  1, "s",     false, false);
+    addCommand("verbose",             CMD_VERBOSE,             1,  1, "s",     false, false);
+    addCommand("help",                CMD_HELP,                0,  0, "",      false, false);
+    addCommand("quit",                CMD_QUIT,                0,  0, "",      false, false);
+    addCommand("submit",              CMD_SUBMIT,              1, -1, "s",     false, false);
+    addCommand("status",              CMD_STATUS,              1,  1, "i",     false, false);
+    addCommand("wait",                CMD_WAIT,                1,  2, "id",    false, false);
+    addCommand("cancel",              CMD_CANCEL,              1,  1, "i",     false, false);
+    addCommand("stats",               CMD_STATS,               0,  1, "s",     false, false);
+
+    cmdStats.assign(CMD_NUM, CommandStats());
+}
+
+/************************************************************************/
+void ToolIncorporator::addCommand(const string &name, const int id, const int minArgs, const int maxArgs, const string &types, const bool isLong, const bool changesModel)
+{
+    CommandInfo info;
+    info.id = id;
+    info.name = name;
+    info.minArgs = minArgs;
+    info.maxArgs = maxArgs;
+    info.types = types;
+    info.isLong = isLong;
+    info.changesModel = changesModel;
+    commands[name] = info;
+    if ((int)cmdNames.size() <= id)
+        cmdNames.resize(id + 1);
+    cmdNames[id] = name;
+}
+
+/************************************************************************/
+bool ToolIncorporator::checkArgs(const CommandInfo &info, const Bottle &command, Bottle &reply)
+{   // Checks the number and type of the arguments of a command against its entry on the command table.
+    int nArgs = command.size() - 1;
+    if ((nArgs < info.minArgs) || ((info.maxArgs >= 0) && (nArgs > info.maxArgs))){
+        reply.addString("[nack]");
+        reply.addString("Wrong number of arguments for '" + info.name + "', type [help] for its usage.");
+        return false;
+    }
+    for (int i = 0; (i < nArgs) && (i < (int)info.types.size()); i++)
+    {
+        const Value &arg = command.get(i + 1);
+        bool ok = true;
+        switch (info.types[i])
+        {
+        case 's':   ok = arg.isString();                                            break;
+        case 'i':   ok = arg.isInt();                                               break;
+        case 'd':   ok = arg.isDouble() || arg.isInt();                             break;
+        case 'b':   ok = arg.isBool() || arg.isInt() || arg.isVocab() || arg.isString();   break;
+        }
+        if (!ok){
+            stringstream msg;
+            msg << "Argument " << i + 1 << " of '" << info.name << "' has the wrong type (" << arg.toString() << "), type [help] for its usage.";
+            reply.addString("[nack]");
+            reply.addString(msg.str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/************************************************************************/
+void ToolIncorporator::recordStats(const int cmdId, const bool ok, const double time)
+{   // Keeps count of the calls to each command, and a histogram of their latencies in power-of-two buckets of milliseconds.
+    double ms = time*1000.0;
+    int bucket = (ms < 1.0) ? 0 : 1 + (int)floor(log(ms)/log(2.0));
+    if (bucket >= CommandStats::numBuckets)
+        bucket = CommandStats::numBuckets - 1;
+
+    statsMutex.lock();
+    CommandStats &st = cmdStats[cmdId];
+    st.count++;
+    if (!ok)
+        st.failures++;
+    st.totalTime += time;
+    if (time > st.maxTime)
+        st.maxTime = time;
+    st.hist[bucket]++;
+    statsMutex.unlock();
+}
+
+/************************************************************************/
+void ToolIncorporator::getStats(Bottle &statsB)
+{   // Adds a list (name count failures meanTime maxTime (histogram)) for each command called.
+    statsMutex.lock();
+    for (int id = 0; id < CMD_NUM; id++)
+    {
+        const CommandStats &st = cmdStats[id];
+        if (st.count == 0)
+            continue;
+        Bottle &cmdB = statsB.addList();
+        cmdB.addString(cmdNames[id]);
+        cmdB.addInt(st.count);
+        cmdB.addInt(st.failures);
+        cmdB.addDouble(st.totalTime/st.count);
+        cmdB.addDouble(st.maxTime);
+        Bottle &histB = cmdB.addList();
+        for (int b = 0; b < CommandStats::numBuckets; b++)
+            histB.addInt(st.hist[b]);
+    }
+    statsMutex.unlock();
+}
+
 /************************************************************************/
 bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 {
@@ -377,11 +660,235 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
 	/* Get command string */
 	string receivedCmd = command.get(0).asString().c_str();
+
+    map<string, CommandInfo>::const_iterator cmdIt = commands.find(receivedCmd);
+    if (cmdIt == commands.end()){
+        reply.addString("[nack]");
+        reply.addString("Invalid command, type [help] for a list of accepted commands.");
+        return true;
+    }
+    const CommandInfo &info = cmdIt->second;
+
+    // Commands run directly by the module (not through the job queue) are timed on execute().
+    if (info.id < CMD_SUBMIT){
+        // Long commands can not run while a job is running, as they would compete for the robot and the model.
+        // Neither can those that change the model, pose or tooltip. Queries read the state published by the job.
+        if ((info.isLong || info.changesModel) && jobThrd->isBusy()){
+            reply.addString("[nack]");
+            reply.addString("Busy running a job, cancel it or wait for it to finish.");
+            recordStats(info.id, false, 0.0);
+            return true;
+        }
+        // The reply carries the result, [nack] included. Returning false would let RFModule replace it.
+        execute(command, reply);
+        return true;
+    }
+
+    if (!checkArgs(info, command, reply))
+        return true;
+
+    double t0 = Time::now();
+    bool ok = true;
+
+    //================================= JOB COMMANDS ================================
+    // Long commands can be submitted as jobs, which run in the background while other commands are answered.
+    switch (info.id)
+    {
+    case CMD_SUBMIT:
+    {
+        Bottle jobCmd = command.tail();
+        map<string, CommandInfo>::const_iterator jobIt = commands.find(jobCmd.get(0).asString());
+        if ((jobIt == commands.end()) || (!jobIt->second.isLong)){
+            reply.addString("[nack]");
+            reply.addString("Only long commands can be submitted as jobs.");
+            ok = false;
+            break;
+        }
+        if (!checkArgs(jobIt->second, jobCmd, reply)){
+            ok = false;
+            break;
+        }
+        int id = jobThrd->submit(jobCmd);
+        if (id < 0){
+            reply.addString("[nack]");
+            reply.addString("Busy running a job, cancel it or wait for it to finish.");
+            ok = false;
+            break;
+        }
+        reply.addString("[ack]");
+        reply.addInt(id);
+        break;
+    }
+    case CMD_STATUS:
+    case CMD_WAIT:
+    {
+        int id = command.get(1).asInt();
+        if (info.id == CMD_WAIT){
+            // The RPC port serves one request at a time, so the wait is bounded, and clients wait again if needed.
+            double timeout = (command.size() > 2) ? command.get(2).asDouble() : maxWaitTime;
+            if ((timeout <= 0.0) || (timeout > maxWaitTime))
+                timeout = maxWaitTime;
+            jobThrd->wait(id, timeout);
+        }
+
+        JobThread::Job job;
+        if (!jobThrd->getJob(id, job)){
+            reply.addString("[nack]");
+            reply.addString("Unknown job.");
+            ok = false;
+            break;
+        }
+        double tRef = (job.tEnd > 0.0) ? job.tEnd : Time::now();
+        reply.addString("[ack]");
+        reply.addInt(job.id);
+        reply.addString(JobThread::stateName(job.state));
+        reply.addDouble(job.progress);
+        reply.addString(job.progressMsg);
+        reply.addDouble((job.tStart > 0.0) ? tRef - job.tStart : 0.0);
+        reply.addList() = job.reply;
+        break;
+    }
+    case CMD_CANCEL:
+    {
+        int id = command.get(1).asInt();
+        if (jobThrd->cancel(id)){
+            reply.addString("[ack]");
+        }else{
+            reply.addString("[nack]");
+            reply.addString("Job not queued or running.");
+            ok = false;
+        }
+        break;
+    }
+    case CMD_STATS:
+    {
+        if (command.get(1).asString() == "pipes"){
+            // The pipelines are run by jobs, and their record is rewritten on every run
+            if (jobThrd->isBusy()){
+                reply.addString("[nack]");
+                reply.addString("Busy running a job, cancel it or wait for it to finish.");
+                ok = false;
+                break;
+            }
+            const char *pipeNames[] = {"pipe_rec", "pipe_merge", "pipe_explore", "pipe_filter", "pipe_sym"};
+            CloudPipeline *pipes[] = {&recPipe, &mergePipe, &explorePipe, &filterPipe, &symPipe};
+            reply.addString("[ack]");
+            for (int p = 0; p < 5; p++)
+            {
+                Bottle &pipeB = reply.addList();
+                pipeB.addString(pipeNames[p]);
+                pipes[p]->getStats(pipeB.addList());
+            }
+            break;
+        }
+        reply.addString("[ack]");
+        getStats(reply);
+        if (command.get(1).asString() == "reset"){
+            statsMutex.lock();
+            cmdStats.assign(CMD_NUM, CommandStats());
+            statsMutex.unlock();
+        }
+        break;
+    }
+    }
+
+    recordStats(info.id, ok, Time::now() - t0);
+    return true;
+}
+
+/**********************************************************/
+bool ToolIncorporator::isLongCommand(const string &cmd)
+{   // Commands that move the robot or process clouds for a long time, which can be run as jobs.
+    map<string, CommandInfo>::const_iterator cmdIt = commands.find(cmd);
+    return (cmdIt != commands.end()) && cmdIt->second.isLong;
+}
+
+/**********************************************************/
+bool ToolIncorporator::execute(const Bottle &command, Bottle &reply)
+{
+    /* Executes a command, either from the RPC port or as a job. Returns whether it succeeded, the reply holds the result either way */
+    reply.clear();  // Clear reply bottle
+
+    map<string, CommandInfo>::const_iterator cmdIt = commands.find(command.get(0).asString());
+    if (cmdIt == commands.end()){
+        reply.addString("[nack]");
+        reply.addString("Invalid command, type [help] for a list of accepted commands.");
+        return true;
+    }
+    const CommandInfo &info = cmdIt->second;
+    if (!checkArgs(info, command, reply)){
+        recordStats(info.id, false, 0.0);
+        return false;
+    }
+
+    double t0 = Time::now();
+    bool ok = dispatch(info.id, command, reply);
+    recordStats(info.id, ok, Time::now() - t0);
+
+    // Queries see the state left by this command from now on. Others did not change it, and may be running beside a job.
+    if (info.isLong || info.changesModel)
+        publishState(true);
+
+    // Whatever the command left to draw is sent now, in one go.
+    flushVisualizer();
+
+    return ok;
+}
+
+/**********************************************************/
+void ToolIncorporator::publishState(const bool withClouds)
+{   // Called from the thread that runs the commands, which is the only one that changes the state.
+    stateMutex.lock();
+    published.cloudLoaded = cloudLoaded;
+    published.poseFound = poseFound;
+    published.toolName = saveName;
+    published.toolPose = toolPose;
+    stateMutex.unlock();
+
+    if (withClouds){
+        // Copied outside the lock, and swapped in, so that queries keep the copy they hold
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr poseCopy(new pcl::PointCloud<pcl::PointXYZRGB>(*cloud_pose));
+        stateMutex.lock();
+        published.cloud_pose = poseCopy;
+        stateMutex.unlock();
+    }
+}
+
+/**********************************************************/
+void ToolIncorporator::getState(ToolState &state)
+{
+    stateMutex.lock();
+    state = published;
+    stateMutex.unlock();
+}
+
+/**********************************************************/
+bool ToolIncorporator::cancelled()
+{
+    return closing || ((jobThrd != NULL) && jobThrd->isCancelled());
+}
+
+/**********************************************************/
+void ToolIncorporator::reportProgress(const double progress, const string &msg)
+{
+    if (verbose){ cout << "Progress " << (int)(progress*100) << "%: " << msg << endl;}
+    publishState(false);    // each step of a job makes the pose found so far queryable
+    if (jobThrd != NULL)
+        jobThrd->setProgress(progress, msg);
+}
+
+/**********************************************************/
+bool ToolIncorporator::dispatch(const int cmdId, const Bottle &command, Bottle &reply)
+{
+    /* Runs the command with the given id. Arguments have already been validated against the command table */
 	int responseCode;   //Will contain Vocab-encoded response
 
+    switch (cmdId)
+    {
     //================================= GET MODEL COMMANDS ================================
 
-    if (receivedCmd == "loadCloud"){
+    case CMD_LOADCLOUD:
+    {
         string cloud_name = command.get(1).asString();
         loadCloud(cloud_name, cloud_model);
 
@@ -390,8 +897,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
         reply.addString("[ack]");
         return true;
-
-    }else if (receivedCmd == "saveCloud"){
+    }
+    case CMD_SAVECLOUD:
+    {
 
         string cloud_name;
         if (command.size() < 2){
@@ -401,12 +909,14 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         }
 
 
-        saveCloud(cloud_name, cloud_pose);
+        ToolState state;
+        getState(state);
+        saveCloud(cloud_name, state.cloud_pose);
         reply.addString("[ack]");
         return true;
-
-
-    }else if (receivedCmd == "get3D"){
+    }
+    case CMD_GET3D:
+    {
         // segment object and get the pointcloud using objectReconstrucor module save it in file or array
         pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec (new pcl::PointCloud<pcl::PointXYZRGB> ());
         bool ok = getPointCloud(cloud_rec);
@@ -427,8 +937,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
         reply.addString("[ack]");
         return true;
-
-    }else if (receivedCmd == "filter"){
+    }
+    case CMD_FILTER:
+    {
 
         if (!cloudLoaded){
             cout << "Model needed to filter. Load model" << endl;
@@ -447,9 +958,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
         reply.addString("[ack]");
         return true;
-
-
-    }else if (receivedCmd == "exploreTool"){
+    }
+    case CMD_EXPLORETOOL:
+    {
 
         // Retrieve mandatory parameter label
         if (command.size() < 2){
@@ -492,11 +1003,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         }
 
         return false;
-
-
-
-
-    }else if (receivedCmd == "turnHand"){
+    }
+    case CMD_TURNHAND:
+    {
             // Turn the hand 'int' degrees, or go to 0 if no parameter was given.
             int rotDegX = 0;
             int rotDegY = 0;
@@ -521,9 +1030,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
                 reply.addString("[nack] Couldnt go to the desired position." );
                 return false;
             }
-
-
-    }else if (receivedCmd == "lookAtTool"){
+        break;
+    }
+    case CMD_LOOKATTOOL:
+    {
         bool ok = lookAtTool();
         if (ok){
             reply.addString("[ack]");
@@ -533,8 +1043,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack] Couldnt look at the tool." );
             return false;
         }
-
-    }else if (receivedCmd == "lookAround"){
+        break;
+    }
+    case CMD_LOOKAROUND:
+    {
         bool wait = true;
         if (command.size() == 2){
             wait = command.get(1).asBool();
@@ -548,8 +1060,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack] Couldnt look around." );
             return false;
         }
-
-    }else if (receivedCmd == "cleartool"){
+        break;
+    }
+    case CMD_CLEARTOOL:
+    {
 
         //clear clouds
         cloud_model->clear();
@@ -572,17 +1086,14 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         tooltipCanon = tooltip;
 
         // Clear visualizer
-        Bottle cmdVis, replyVis;
-        cmdVis.clear();	replyVis.clear();
-        cmdVis.addString("clearVis");
-        rpcVisualizerPort.write(cmdVis,replyVis);
+        visualizer.clear();
 
         reply.addString("[ack]");
 
         return true;
-
-
-    }else if (receivedCmd == "learn"){
+    }
+    case CMD_LEARN:
+    {
         if (command.size() < 2){
             cout << "Need a label to learn" << endl;
             reply.addString("[nack] Need a label to learn. \n");
@@ -602,9 +1113,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack]");
             return false;
         }
-
-
-    }else if (receivedCmd == "recog"){
+        break;
+    }
+    case CMD_RECOG:
+    {
 
         string label_pred;
 
@@ -624,10 +1136,13 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack]");
             return false;
         }
+        break;
+    }
 
-//================================= POSE COMMANDS ================================
+    //================================= POSE COMMANDS ================================
 
-    }else if (receivedCmd == "findPoseAlign"){
+    case CMD_FINDPOSEALIGN:
+    {
         // Check if model is loaded, else return false
         if (!cloudLoaded){
             cout << "Model needed to find Pose. Load model" << endl;
@@ -651,9 +1166,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack]\n");
             return false;
         }
-
-
-    }else if (receivedCmd == "setPoseParam"){
+        break;
+    }
+    case CMD_SETPOSEPARAM:
+    {
         // Setting default valules
         double ori = 0.0;
         double disp = 0.0;
@@ -687,8 +1203,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
         reply.addString("[ack]");
         return true;
-
-    }else if (receivedCmd == "makecanon"){
+    }
+    case CMD_MAKECANON:
+    {
 
         pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_canon (new pcl::PointCloud<pcl::PointXYZRGB> ());
 
@@ -707,15 +1224,12 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         sendPointCloud(cloud_canon);
         reply.addString("[ack]");
         return true;
-
-
-    }else if (receivedCmd == "alignFromFiles"){
+    }
+    case CMD_ALIGNFROMFILES:
+    {
 
        // Clear visualizer
-       Bottle cmdVis, replyVis;
-       cmdVis.clear();	replyVis.clear();
-       cmdVis.addString("clearVis");
-       rpcVisualizerPort.write(cmdVis,replyVis);
+       visualizer.clear();
 
        string cloud_from_name = command.get(1).asString();
        string cloud_to_name = command.get(2).asString();
@@ -734,16 +1248,12 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
            return false;
        }
 
-       Time::delay(1.0);
        CloudUtils::addNoise(cloud_from, noise_mean , noise_sigma);
        CloudUtils::changeCloudColor(cloud_from, blue);      // Plot partial view blue
        sendPointCloud(cloud_from);
 
        // Set accumulator mode.
-       cmdVis.clear();	replyVis.clear();
-       cmdVis.addString("accumClouds");
-       cmdVis.addInt(1);
-       rpcVisualizerPort.write(cmdVis,replyVis);
+       visualizer.accumulate(true);
 
        // load model cloud to align to
        cout << "Attempting to load " << (cloudsPathFrom + cloud_to_name).c_str() << "... "<< endl;
@@ -754,8 +1264,8 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
            return false;
        }
 
-       Time::delay(1.0);
-       sendPointCloud(cloud_to);
+       int modelVersion = ++cloudVersion;
+       sendPointCloud(cloud_to, "model", modelVersion);
        findTooltipCanon(cloud_to, tooltipCanon);
 
        // Show clouds original position
@@ -786,82 +1296,93 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
        showTooltip(tooltip, green);
 
-       //Display oriented cloud.
-       sendPointCloud(cloud_pose);
-       Time::delay(1.0);
+       //Display oriented cloud (only the pose and color are sent to the visualizer, which has the model already).
+       sendCloudUpdate(cloud_pose, "model", modelVersion, green, poseMatrix);
 
-       cmdVis.clear();	replyVis.clear();
-       cmdVis.addString("accumClouds");
-       cmdVis.addInt(0);
-       rpcVisualizerPort.write(cmdVis,replyVis);
+       visualizer.accumulate(false);
 
        reply.addString("[ack]");
        reply.addList().read(poseMatYARP);
        return true;
+    }
+    case CMD_GETORI:         // Returns the orientation of the tool  (in degrees around -Y axis)
+    {
 
-
-    }else if (receivedCmd == "getOri"){         // Returns the orientation of the tool  (in degrees around -Y axis)
-
-        if (!poseFound){
+        ToolState state;
+        getState(state);
+        if (!state.poseFound){
             cout << "Pose needed to get params" << endl;
             reply.addString("[nack] Compute pose first.");
             return false;
         }
 
         double ori, dum1, dum2, dum3;
-        paramFromPose(toolPose,ori, dum1, dum2, dum3);
+        paramFromPose(state.toolPose,ori, dum1, dum2, dum3);
         reply.addString("[ack]");
         reply.addDouble(ori);
         return true;
-    }else if (receivedCmd == "getDisp"){         // Returns the orientation of the tool  (in degrees around -Y axis)
-        if (!poseFound){
+    }
+    case CMD_GETDISP:         // Returns the orientation of the tool  (in degrees around -Y axis)
+    {
+        ToolState state;
+        getState(state);
+        if (!state.poseFound){
             cout << "Pose needed to get params" << endl;
             reply.addString("[nack] Compute pose first.");
             return false;
         }
 
         double displ, dum1, dum2, dum3;
-        paramFromPose(toolPose,dum1,displ, dum2, dum3);
+        paramFromPose(state.toolPose,dum1,displ, dum2, dum3);
         reply.addString("[ack]");
         reply.addDouble(displ);
         return true;
-    }else if (receivedCmd == "getTilt"){         // Returns the orientation of the tool  (in degrees around -Y axis)
-        if (!poseFound){
+    }
+    case CMD_GETTILT:         // Returns the orientation of the tool  (in degrees around -Y axis)
+    {
+        ToolState state;
+        getState(state);
+        if (!state.poseFound){
             cout << "Pose needed to get params" << endl;
             reply.addString("[nack] Compute pose first.");
             return false;
         }
 
         double tilt, dum1, dum2, dum3;
-        paramFromPose(toolPose,dum1, dum2, tilt, dum3);
+        paramFromPose(state.toolPose,dum1, dum2, tilt, dum3);
         reply.addString("[ack]");
         reply.addDouble(tilt);
         return true;
-    }else if (receivedCmd == "getShift"){         // Returns the orientation of the tool  (in degrees around -Y axis)
-        if (!poseFound){
+    }
+    case CMD_GETSHIFT:         // Returns the orientation of the tool  (in degrees around -Y axis)
+    {
+        ToolState state;
+        getState(state);
+        if (!state.poseFound){
             cout << "Pose needed to get params" << endl;
             reply.addString("[nack] Compute pose first.");
             return false;
         }
 
         double shift, dum1, dum2, dum3;
-        paramFromPose(toolPose,dum1, dum2, dum3, shift);
+        paramFromPose(state.toolPose,dum1, dum2, dum3, shift);
         reply.addString("[ack]");
         reply.addDouble(shift);
         return true;
-
-
-    }else if (receivedCmd == "clearpose"){
+    }
+    case CMD_CLEARPOSE:
+    {
         toolPose.resize(4,4);
         toolPose.eye();
         poseFound = false;
         reply.addString("[ack]");
         return true;
+    }
 
+    //================================= TOOLTIP ESTIMATION ================================
 
-//================================= TOOLTIP ESTIMATION ================================
-
-    }else if (receivedCmd == "findTooltipCanon"){
+    case CMD_FINDTOOLTIPCANON:
+    {
         // Check if model is loaded, else return false
         if (!cloudLoaded){
             cout << "Model needed to find tooltip. Load model" << endl;
@@ -886,9 +1407,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         reply.addDouble(tooltipCanon.z);
 
         return true;
-
-
-    }else if (receivedCmd == "findTooltipParam"){   // Function only for simulation
+    }
+    case CMD_FINDTOOLTIPPARAM:         // Function only for simulation
+    {
 
         // Check if model is loaded, else return false
         if (!cloudLoaded){
@@ -939,9 +1460,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         reply.addDouble(tooltip.y);
         reply.addDouble(tooltip.z);
         return true;
-
-
-    }else if (receivedCmd == "findTooltipAlign"){
+    }
+    case CMD_FINDTOOLTIPALIGN:
+    {
         // Check if model is loaded, else return false
         if (!cloudLoaded){
             cout << "Model needed to find tooltip. Load model" << endl;
@@ -1000,9 +1521,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
         cout << "Reply Formatted" << endl;
         return true;
-
-
-    }else if (receivedCmd == "findSyms"){
+    }
+    case CMD_FINDSYMS:
+    {
 
         // Check if model is loaded, else return false
         if (!cloudLoaded){
@@ -1025,8 +1546,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         reply.addString("[ack]");
 
         return true;
-
-    }else if (receivedCmd == "findTooltipSym"){
+    }
+    case CMD_FINDTOOLTIPSYM:
+    {
         // Check if symmetry has been found already, else return false
         if (!symFound){
             cout << "Need to find main planes before finding the tooltip this way" << endl;
@@ -1048,9 +1570,7 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
         cout << "Tooltip found at ( " << tooltip.x <<  ", " << tooltip.y <<  ", "<< tooltip.z <<  "). " << endl;
 
-        Time::delay(0.5);
         showTooltip(tooltip, green);
-        Time::delay(0.5);
 
         reply.addString("[ack]");
         reply.addDouble(tooltip.x);
@@ -1058,9 +1578,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         reply.addDouble(tooltip.z);
 
         return true;
-
-
-    }else if (receivedCmd == "cleartip"){
+    }
+    case CMD_CLEARTIP:
+    {
         tooltip.x = 0.0;
         tooltip.y = 0.0;
         tooltip.z = 0.0;
@@ -1074,8 +1594,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         return true;
 
 // ======================= AFFORDANCES ================================
-
-    }else if (receivedCmd == "getAffordance"){
+        break;
+    }
+    case CMD_GETAFFORDANCE:
+    {
 
         Bottle aff;
         bool all = false;
@@ -1084,7 +1606,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         }
 
         bool ok;
-        ok = getAffordances(aff, all);
+        ToolState state;
+        getState(state);
+        ok = getAffordances(state, aff, all);
         reply = aff;
         if (ok){
             return true;
@@ -1094,8 +1618,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("error");
             return true;
         }
-
-    }else if (receivedCmd == "extractFeats"){
+        break;
+    }
+    case CMD_EXTRACTFEATS:
+    {
         if(!extractFeats()){
             cout << "Could not extract the features" << endl;
             reply.addString("[nack]Features not extracted.");
@@ -1108,8 +1634,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
 
 
 // =======================  PARAMETER SET  =======================
-
-    }else if (receivedCmd == "handFrame"){
+        break;
+    }
+    case CMD_HANDFRAME:
+    {
         // activates the normalization of the pointcloud to the hand reference frame.
         bool ok = setHandFrame(command.get(1).asString());
         if (ok){
@@ -1120,9 +1648,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack] Transformation to hand frame has to be set to ON or OFF. ");
             return false;
         }
-
-
-    }else if (receivedCmd == "FPFH"){
+        break;
+    }
+    case CMD_FPFH:
+    {
         // activates the normalization of the pointcloud to the hand reference frame.
         bool ok = setInitialAlignment(command.get(1).asString());
         if (ok){
@@ -1133,8 +1662,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack] FPFH based Initial Alignment has to be set to ON or OFF. ");            
             return false;
         }
-
-    }else if (receivedCmd == "setbb"){
+        break;
+    }
+    case CMD_SETBB:
+    {
         // activates the normalization of the pointcloud to the hand reference frame.
         bool depth;
         if (command.size() == 1){
@@ -1155,9 +1686,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("[nack] Bounding box parameters not updated. ");
             return false;
         }
-
-
-    }else if (receivedCmd == "icp"){
+        break;
+    }
+    case CMD_ICP:
+    {
         // icp -> sets parameters for iterative closest point aligning algorithm        
         icp_maxIt = command.get(1).asInt();
         icp_maxCorr = command.get(2).asDouble();
@@ -1166,17 +1698,18 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         cout << " icp Parameters set to " <<  icp_maxIt << ", " << icp_maxCorr << ", " << icp_ranORT<< ", " << icp_transEp << endl;
         reply.addString("[ack]");
         return true;
-
-
-    }else if (receivedCmd == "noise"){
+    }
+    case CMD_NOISE:
+    {
         // noise -> sets parameters for noise addition for align test
         noise_mean = command.get(1).asDouble();
         noise_sigma = command.get(2).asDouble();
         cout << "Noise Parameters set to mean:" <<  noise_mean << ", sigma: " << noise_sigma << endl;
         reply.addString("[ack]");
         return true;
-
-    }else if (receivedCmd == "showTipProj"){
+    }
+    case CMD_SHOWTIPPROJ:
+    {
         bool ok = showTipProj(command.get(1).asString());
         if (ok){
             reply.addString("[ack]");
@@ -1188,9 +1721,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("Verbose can only be set to ON or OFF.");
             return false;
         }
-
-
-    }else if (receivedCmd == "seg2D"){
+        break;
+    }
+    case CMD_SEG2D:
+    {
         bool ok = setSeg(command.get(1).asString());
         if (ok){
             reply.addString("[ack]");
@@ -1202,9 +1736,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("Verbose can only be set to ON or OFF.");
             return false;
         }
-
-
-    }else if (receivedCmd == "savename"){
+        break;
+    }
+    case CMD_SAVENAME:
+    {
         // changes the name with which files will be saved by the object-reconstruction module
         string save_name;
         if (command.size() >= 2){
@@ -1215,6 +1750,9 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         }
         bool ok = changeSaveName(save_name);
         if (ok){
+            stateMutex.lock();
+            published.toolName = saveName;
+            stateMutex.unlock();
             reply.addString("[ack]");
             return true;
         }else {
@@ -1223,9 +1761,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("Couldnt change the name. ");
             return false;
         }
-
-
-    }else if (receivedCmd == "saving"){
+        break;
+    }
+    case CMD_SAVING:
+    {
         // changes whether the reconstructed clouds will be saved or not.
         bool ok = setSaving(command.get(1).asString());
         if (ok){
@@ -1237,8 +1776,25 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("Saving can only be set to ON or OFF.");
             return false;
         }
-
-    }else if (receivedCmd == "verbose"){
+        break;
+    }
+    case CMD_FAST:
+    {
+        // changes whether the module waits for clouds to be displayed or not.
+        bool ok = setFast(command.get(1).asString());
+        if (ok){
+            reply.addString("[ack]");
+            return true;
+        }else {
+            fprintf(stdout,"Fast mode can only be set to ON or OFF. \n");
+            reply.addString("[nack]");
+            reply.addString("Fast mode can only be set to ON or OFF.");
+            return false;
+        }
+        break;
+    }
+    case CMD_VERBOSE:
+    {
         bool ok = setVerbose(command.get(1).asString());
         if (ok){
             reply.addString("[ack]");
@@ -1250,9 +1806,10 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
             reply.addString("Verbose can only be set to ON or OFF.");
             return false;
         }
-
-
-	}else if (receivedCmd == "help"){
+        break;
+    }
+    case CMD_HELP:
+    {
 		reply.addVocab(Vocab::encode("many"));
 		responseCode = Vocab::encode("ack");
         reply.addString("Available commands are:");
@@ -1291,6 +1848,14 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         reply.addString("getAffordance - returns the pre-learnt affordances for the loaded tool-pose.");
         reply.addString("extractFeats - Sends the oriented model out and calls TFE to compute features.");
 
+        reply.addString("---------- JOBS ------------");
+        reply.addString("submit (command ...) - Runs a long command (e.g. exploreTool, findPoseAlign, findTooltipSym) in the background and returns its job id.");
+        reply.addString("status (int)id - Returns state, progress, message, elapsed time and reply of the job.");
+        reply.addString("wait (int)id [(double)timeout] - Waits for the job to finish (or timeout, at most 5 s, as no other command is answered meanwhile) and returns its status.");
+        reply.addString("cancel (int)id - Asks the job to stop at the next safe point.");
+        reply.addString("stats [reset] - Returns (name count failures meanTime maxTime (latency histogram)) for each command called. Buckets: <1ms, [1,2)ms, [2,4)ms ... ");
+        reply.addString("stats pipes - Returns (pipeline ((stage pointsIn pointsOut time) ...)) for the last run of each cloud pipeline.");
+
         reply.addString("---------- SET PARAMETERS ------------");
         reply.addString("handFrame (ON/OFF) - Activates/deactivates transformation of the registered clouds to the hand coordinate frame. (default ON).");
         reply.addString("FPFH (ON/OFF) - Activates/deactivates fast local features (FPFH) based Initial alignment for registration. (default ON).");
@@ -1301,22 +1866,24 @@ bool ToolIncorporator::respond(const Bottle &command, Bottle &reply)
         reply.addString("savename (string) - Changes the name with which the pointclouds will be saved.");
         reply.addString("saving (ON/OFF) - Controls whether recorded clouds are saved or not.");
         reply.addString("showTipProj (ON/OFF) - Controls whether tooltip projection is displayed or not.");
+        reply.addString("fast (ON/OFF) - Sets ON/OFF fast mode, in which the module does not wait for clouds to be displayed.");
         reply.addString("verbose (ON/OFF) - Sets ON/OFF printouts of the program, for debugging or visualization.");
         reply.addString("help - produces this help.");
 		reply.addString("quit - closes the module.");
 
 		reply.addVocab(responseCode);
 		return true;
-
-    } else if (receivedCmd == "quit"){
+    }
+    case CMD_QUIT:
+    {
         reply.addString("[ack]");
 		closing = true;
 		return true;
-	}
-    
-    reply.addString("Invalid command, type [help] for a list of accepted commands.");    
-    return true;
+    }
+    }
 
+    reply.addString("Invalid command, type [help] for a list of accepted commands.");
+    return true;
 }
 
 
@@ -1399,9 +1966,9 @@ bool ToolIncorporator::turnHand(const int rotDegX, const int rotDegY, const bool
 
         iGaze->blockEyes(5.0);
         iGaze->lookAtFixationPoint(xTR);
-        iGaze->waitMotionDone(0.1);
+        iGaze->waitMotionDone(0.1, motionTimeout);
 
-        iCartCtrl->waitMotionDone(0.1);
+        iCartCtrl->waitMotionDone(0.1, motionTimeout);
         iCartCtrl->restoreContext(context_arm);
         iCartCtrl->deleteContext(context_arm);
     }
@@ -1442,7 +2009,7 @@ bool ToolIncorporator::lookAtTool(){
         cout << "Looking at initial tooltip guess" << endl;
         iGaze->blockEyes(5.0);
         iGaze->lookAtFixationPoint(xTR);
-        iGaze->waitMotionDone(0.1);
+        iGaze->waitMotionDone(0.1, motionTimeout);
 
         // Refine the tooltip by getting the 2D estimate from the 3D segmentation.
         // Keep on updting the 2D ttip until it is stable (distance under 20 pixels, or 5 steps).
@@ -1454,14 +2021,14 @@ bool ToolIncorporator::lookAtTool(){
         int camSel=(camera=="left")?0:1;
             get2Dtooltip(true, ttip2D);
             iGaze->lookAtMonoPixel(camSel, ttip2D);
-            iGaze->waitMotionDone(0.1);
+            iGaze->waitMotionDone(0.1, motionTimeout);
         */
 
         while ((tt_dist > 150) && (ref_step < 3)){ // Repeat until tooltip is stable or 5 steps.
             cout << "Following the tool from my hand. Step " << ref_step <<endl;
             get2Dtooltip(true, ttip2D);
             iGaze->lookAtMonoPixel(camSel, ttip2D);
-            iGaze->waitMotionDone(0.1);
+            iGaze->waitMotionDone(0.1, motionTimeout);
             tt_dist = pow(ttip2D[0]-ttip2D_prev[0], 2) + pow(ttip2D[1]-ttip2D_prev[1], 2);       //calculating Euclidean distance
             tt_dist = sqrt(tt_dist);
             ttip2D_prev = ttip2D;
@@ -1480,7 +2047,7 @@ bool ToolIncorporator::lookAtTool(){
         //cout << "Initial guess for the tool is at coordinates (" << xTR[0] << ", "<< xTR[1] << ", "<< xTR[2] << ")." << endl;
         iGaze->blockEyes(5.0);
         iGaze->lookAtFixationPoint(xTR);
-        iGaze->waitMotionDone(0.1);
+        iGaze->waitMotionDone(0.1, motionTimeout);
     }
 
     return true;
@@ -1497,7 +2064,7 @@ bool ToolIncorporator::lookAtHand(){
     // Transform point to robot coordinates:
     iGaze->blockEyes(5.0);
     iGaze->lookAtFixationPoint(xH);
-    iGaze->waitMotionDone(0.1);
+    iGaze->waitMotionDone(0.1, motionTimeout);
 
     return true;
 }
@@ -1517,38 +2084,40 @@ bool ToolIncorporator::exploreTool(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_
     away[2] = 0.15;
 
     otherHandCtrl->goToPose(away, awayOr);
-    otherHandCtrl->waitMotionDone();
+    otherHandCtrl->waitMotionDone(0.1, motionTimeout);
 
     // Rotates the tool in hand
     cout << " ====================================== Starting Exploration  =======================================" <<endl;
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec (new pcl::PointCloud<pcl::PointXYZRGB> ());
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_aligned (new pcl::PointCloud<pcl::PointXYZRGB> ());
-    Eigen::Matrix4f alignMatrix;
-    Eigen::Matrix4f poseMatrix;
     double spDist = 0.004;
     double hand_rad = 0.08; // Set a small radius for hand removal, so that as much handle as possible is preserved.
 
+    // Captured views are filtered, aligned and fused into the model by a worker thread, while the hand moves to the next view.
+    cloud_rec_merged->points.clear();
+    ExploreThread explorer(this, cloud_rec_merged);
+
     turnHand(0,0, false);
 
     if (flag3D){
     // gets successive partial reconstructions and returns a merge-> cloud_model
-        cloud_rec_merged->points.clear();
 
         // Clear visualizer
-        Bottle cmdVis, replyVis;
-        cmdVis.clear();	replyVis.clear();
-        cmdVis.addString("clearVis");
-        rpcVisualizerPort.write(cmdVis,replyVis);
+        visualizer.clear();
+
+        explorer.start();
 
         cout << " Get first cloud" << endl;
         // Get inital cloud model on central orientation
-
-        while(!getPointCloud(cloud_rec_merged, spDist, hand_rad)){          // Keep on getting clouds until one is valid (should be the first)
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec (new pcl::PointCloud<pcl::PointXYZRGB> ());
+        while(!capturePointCloud(cloud_rec, spDist, hand_rad)){          // Keep on getting clouds until one is valid (should be the first)
+            if (cancelled()){
+                explorer.stop();
+                return false;
+            }
             lookAround();
-            spDist = adaptDepth(cloud_rec_merged,spDist);
+            spDist = adaptDepth(cloud_rec,spDist);
             cout <<" Spatial distance adapted to " << spDist <<endl;
         }
-        sendPointCloud(cloud_rec_merged);
+        explorer.addView(cloud_rec);
     }
     if (flag2D){
         // Send train command to ontheFly learner
@@ -1565,12 +2134,11 @@ bool ToolIncorporator::exploreTool(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_
         rpcClassifierPort.write(cmdClas,replyClas);
 
         cout << " Learning first view" << endl;
-        Time::delay(1.0);
+        waitArmStill();
         learn(label);
     }
 
     // Rotate tool in hand
-    bool mergeAlign = true;            // XXX make rpc selectable
     //int x_angle_array[] = {-70,-30,10, 40, 70};
     int x_angle_array[] = {-40, 30};
     //int x_angle_array[] = {-70, 10, 60};
@@ -1583,6 +2151,15 @@ bool ToolIncorporator::exploreTool(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_
     int num_ang = x_angles.size() + y_angles.size();
     for (int i = 0; i< num_ang; i++)
     {
+        if (cancelled()){
+            cout << "Exploration cancelled." << endl;
+            explorer.stop();
+            return false;
+        }
+        stringstream viewMsg;
+        viewMsg << "exploring view " << i + 2 << " of " << num_ang + 1;
+        reportProgress((i + 1.0)/(num_ang + 2.0), viewMsg.str());
+
         if (i < x_angles.size()){
             int degX = x_angles[i];
             cout << endl << endl << " +++++++++++ EXPLORING NEW ANGLE " << degX << "++++++++++++++++++" << endl <<endl;
@@ -1595,45 +2172,21 @@ bool ToolIncorporator::exploreTool(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_
             turnHand(0,degY, false);
         }
 
-        Time::delay(1.0);
+        waitArmStill();
 
         if (flag3D){
-            // Get partial reconstruction
-            cloud_rec->points.clear();
-            cloud_rec->clear();
-
-            while(!getPointCloud(cloud_rec, spDist, hand_rad)){          // Keep on getting clouds until one is valid (should be the first)
+            // Get partial reconstruction, and hand it over to be fused while the hand moves on.
+            pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec (new pcl::PointCloud<pcl::PointXYZRGB> ());
+            while(!capturePointCloud(cloud_rec, spDist, hand_rad)){          // Keep on getting clouds until one is valid (should be the first)
+                if (cancelled()){
+                    explorer.stop();
+                    return false;
+                }
                 lookAround();
                 spDist = adaptDepth(cloud_rec,spDist);
                 cout <<" Spatial distance adapted to " << spDist <<endl;
             }
-            CloudUtils::changeCloudColor(cloud_rec, green);
-            sendPointCloud(cloud_rec);
-
-            // Extra filter cloud_rec (noise adds up from so many clouds).
-            // XXX filterCloud(cloud_rec,cloud_rec,3);
-
-
-            //spDist = adaptDepth(cloud_rec, spDist);
-            if (!mergeAlign){
-                // Add clouds without aligning (aligning is implicit because they are all transformed w.r.t the hand reference frame)
-                *cloud_rec_merged += *cloud_rec;
-            }else{
-                // Align new reconstructions to model so far.
-                alignWithScale(cloud_rec, cloud_rec_merged, cloud_aligned, alignMatrix, 6 , 0.01);
-                poseMatrix = alignMatrix.inverse();             // Inverse the alignment to find tool pose
-                Matrix pose = CloudUtils::eigMat2yarpMat(poseMatrix);  // transform pose Eigen matrix to YARP Matrix
-                bool poseValid = checkGrasp(pose);
-
-                if (poseValid)
-                    *cloud_rec_merged += *cloud_aligned;
-            }
-
-            // Downsample to reduce size and fasten computation
-            CloudUtils::downsampleCloud(cloud_rec_merged, cloud_rec_merged, 0.002);
-            cout << " Cloud reconstructed " << endl;
-            CloudUtils::changeCloudColor(cloud_rec_merged, red);
-            sendPointCloud(cloud_rec_merged);
+            explorer.addView(cloud_rec);
         }
 
         if (flag2D){
@@ -1644,18 +2197,15 @@ bool ToolIncorporator::exploreTool(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_
 
     cout << endl << " + + FINISHED TOOL EXPLORATION + + " << endl <<endl;
 
-    // filter spurious noise
-    cout << endl << " + Applying radius outlier removal + " << endl <<endl;
     if (flag3D){
-        for (int i = 0; i < 3; i++){
-            Time::delay(1.0);
-            pcl::RadiusOutlierRemoval<pcl::PointXYZRGB> ror; // -- by neighbours within radius
-            ror.setInputCloud(cloud_rec_merged);
-            ror.setRadiusSearch(0.01);
-            ror.setMinNeighborsInRadius(20);
-            ror.filter(*cloud_rec_merged);
-        }
-        filterCloud(cloud_rec_merged, cloud_rec_merged, 3.0);
+        // Wait for the last views to be fused into the model
+        reportProgress((num_ang + 1.0)/(num_ang + 2.0), "fusing the last views");
+        explorer.waitDone();
+        explorer.stop();
+
+        // filter spurious noise (as defined in 'pipe_explore')
+        cout << endl << " + Applying outlier removal + " << endl <<endl;
+        explorePipe.process(cloud_rec_merged);
         sendPointCloud(cloud_rec_merged);
 
         cout << "FINAL CLOUD MODEL RECONSTRUCTED" << endl;
@@ -1670,6 +2220,56 @@ bool ToolIncorporator::exploreTool(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_
     return true;
 }
 
+/************************************************************************/
+bool ToolIncorporator::fuseView(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec_merged)
+{   // Cleans a view captured during exploration and fuses it into the model reconstructed so far (runs on the exploration thread).
+    bool mergeAlign = true;            // XXX make rpc selectable
+    recPipe.process(cloud_rec);
+
+    // The view was checked on capture, but filtering may have left too few points to align it
+    if (cloud_rec->size() < 300){
+        cout << " Not enough points left after filtering, view of size " << cloud_rec->size() << " skipped." << endl;
+        return false;
+    }
+
+    // The first view is the initial model
+    if (cloud_rec_merged->points.empty()){
+        *cloud_rec_merged = *cloud_rec;
+        sendPointCloud(cloud_rec_merged);
+        return true;
+    }
+
+    CloudUtils::changeCloudColor(cloud_rec, green);
+    sendPointCloud(cloud_rec);
+
+    // Extra filter cloud_rec (noise adds up from so many clouds).
+    // XXX filterCloud(cloud_rec,cloud_rec);
+
+    if (!mergeAlign){
+        // Add clouds without aligning (aligning is implicit because they are all transformed w.r.t the hand reference frame)
+        *cloud_rec_merged += *cloud_rec;
+    }else{
+        // Align new reconstructions to model so far.
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_aligned (new pcl::PointCloud<pcl::PointXYZRGB> ());
+        Eigen::Matrix4f alignMatrix;
+        alignWithScale(cloud_rec, cloud_rec_merged, cloud_aligned, alignMatrix, 6 , 0.01);
+        Eigen::Matrix4f poseMatrix = alignMatrix.inverse();             // Inverse the alignment to find tool pose
+        Matrix pose = CloudUtils::eigMat2yarpMat(poseMatrix);  // transform pose Eigen matrix to YARP Matrix
+        bool poseValid = checkGrasp(pose);
+
+        if (poseValid)
+            *cloud_rec_merged += *cloud_aligned;
+    }
+
+    // Downsample to reduce size and fasten computation (as defined in 'pipe_merge')
+    mergePipe.process(cloud_rec_merged);
+    cout << " Cloud reconstructed " << endl;
+    CloudUtils::changeCloudColor(cloud_rec_merged, red);
+    sendPointCloud(cloud_rec_merged);
+
+    return true;
+}
+
 double ToolIncorporator::adaptDepth(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, double spatial_distance){
     if (cloud->size()> 10000){
         cout << " Spatial distance modified to " << spatial_distance - 0.0001 << endl;
@@ -1696,7 +2296,7 @@ bool ToolIncorporator::lookAround(const bool wait)
     fp_aux[2] = fp[2] + Rand::scalar(-0.02,0.02);
     iGaze->lookAtFixationPoint(fp_aux);
     if (wait){
-        iGaze->waitMotionDone(0.05);
+        iGaze->waitMotionDone(0.05, motionTimeout);
     }
 
     return true;
@@ -1736,7 +2336,7 @@ bool ToolIncorporator::recognize(string &label){
     turnHand(0,0, false);
 
     // Wait until the object is stabilized
-    Time::delay(5.0);
+    waitArmStill(5.0);
 
     // Ask the network to recognize the tool
     cmdClas.clear();	replyClas.clear();
@@ -1873,6 +2473,29 @@ bool ToolIncorporator::get2Dtooltip(bool get3D, Vector &ttip2D)
 /************************************************************************/
 bool ToolIncorporator::getPointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec, double segParam, double handRad)
 {
+    if (!capturePointCloud(cloud_rec, segParam, handRad))
+        return false;
+
+    // Clean the remaining points (as defined in 'pipe_rec')
+    recPipe.process(cloud_rec);
+
+    if (cloud_rec->size() < 300){
+        cout << " Not enough points left after filtering. Something must have happened on reconstruction" << endl;
+        return false;
+    }
+
+    if (verbose){ cout << " Cloud of size " << cloud_rec->points.size() << " obtained from 3D reconstruction" << endl;}
+
+    //if (saving){
+    //    CloudUtils::savePointsPly(cloud_rec, cloudsPathTo, saveName, numCloudsSaved);
+    //}
+
+    return true;
+}
+
+/************************************************************************/
+bool ToolIncorporator::capturePointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec, double segParam, double handRad)
+{   // Gets a reconstruction of the tool, and crops it on the hand frame (with the hand pose at capture time).
     cloud_rec->points.clear();
     cloud_rec->clear();   // clear receiving cloud
 
@@ -1890,90 +2513,47 @@ bool ToolIncorporator::getPointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr clou
 
     // read the cloud from the objectReconst output port
     Bottle *cloudBottle = cloudsInPort.read(true);
+    double captureTime = -1.0;
     if (cloudBottle!=NULL){
         if (verbose){	cout << "Bottle of size " << cloudBottle->size() << " read from port \n"	<<endl;}
         CloudUtils::bottle2cloud(*cloudBottle,cloud_rec);
+
+        // Time at which the cloud was captured, if sent by the reconstruction module
+        Stamp stamp;
+        if (cloudsInPort.getEnvelope(stamp) && stamp.isValid())
+            captureTime = stamp.getTime();
     } else{
         if (verbose){	printf("Couldnt read returned cloud \n");	}
         return false;
     }
 
-    // Transform the cloud's frame so that the bouding box is aligned with the hand coordinate frame
-    if (handFrame) {
-        frame2Hand(cloud_rec, cloud_rec);
-    }
-
     // Apply some filtering to clean the cloud
-    // Process the cloud by removing distant points ...
-    pcl::PassThrough<pcl::PointXYZRGB> passX;
-    passX.setInputCloud (cloud_rec);
-    passX.setFilterFieldName ("x");
-    passX.setFilterLimits (0.0, 0.35);
-    passX.filter (*cloud_rec);
-
-    pcl::PassThrough<pcl::PointXYZRGB> passY;
-    passY.setInputCloud (cloud_rec);
-    passY.setFilterFieldName ("y");
-    passY.setFilterLimits (-0.3, 0.0);
-    passY.filter (*cloud_rec);
-
-    pcl::PassThrough<pcl::PointXYZRGB> passZ;
-    passZ.setInputCloud (cloud_rec);
-    passZ.setFilterFieldName ("z");
-    passZ.setFilterLimits (-0.15, 0.15);
-    passZ.filter (*cloud_rec);
-
-     // ... and removing outliers
-    pcl::StatisticalOutlierRemoval<pcl::PointXYZRGB> sor; //filter to remove outliers
-    sor.setStddevMulThresh (3.0);
-    sor.setInputCloud (cloud_rec);
-    sor.setMeanK(10);
-    sor.filter (*cloud_rec);
-
-
-    // Remove hand (all points within 6 cm from origin)
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_nohand (new pcl::PointCloud<pcl::PointXYZRGB> ());
-    if (handFrame) {        
-        pcl::PointIndices::Ptr pointsTool (new pcl::PointIndices ());
-        for (unsigned int ptI=0; ptI<cloud_rec->points.size(); ptI++)
-        {
-            pcl::PointXYZRGB *pt = &cloud_rec->at(ptI);
-            double distP = sqrt(pt->x*pt->x+pt->y*pt->y+pt->z*pt->z);           // Compute distance around hand reference frame
-            if (distP > handRad){
-                pointsTool->indices.push_back(ptI);
-            }
-        }
-
-        pcl::ExtractIndices<pcl::PointXYZRGB> eifilter (true);
-        eifilter.setInputCloud (cloud_rec);
-        eifilter.setIndices(pointsTool);
-        eifilter.filter(*cloud_nohand);
-
-        cloud_rec->points.clear();
-        *cloud_rec = *cloud_nohand;          //overwrite cloud with filtered one with no points fo hand.
+    // Process the cloud by removing NaNs, distant points and the hand (all points within handRad from origin) in a single pass ...
+    Eigen::Vector3f boxMin(0.0, -0.3, -0.15);
+    Eigen::Vector3f boxMax(0.35, 0.0, 0.15);
+    if (handFrame) {
+        // Transform the cloud's frame so that the bouding box is aligned with the hand coordinate frame.
+        // Box and hand are checked on the robot frame, so only the points that survive the crop get transformed.
+        Eigen::Matrix4f TM;
+        getHandTransform(TM, captureTime);
+        CloudUtils::cropCloud(cloud_rec, TM, boxMin, boxMax, handRad);
+    } else {
+        CloudUtils::cropCloud(cloud_rec, boxMin, boxMax);
     }
 
     //CloudUtils::scaleCloud(cloud_rec, cloud_rec);
 
     // Clean the depth visualization.
-    Time::delay(0.5);
     cmdOR.clear();	replyOR.clear();
     cmdOR.addString("clear");
     rpcObjRecPort.write(cmdOR,replyOR);
 
 
     if (cloud_rec->size() < 300){
-        cout << " Not enough points left after filtering. Something must have happened on reconstruction" << endl;
+        cout << " Not enough points left after cropping. Something must have happened on reconstruction" << endl;
         return false;
     }
 
-
-    if (verbose){ cout << " Cloud of size " << cloud_rec->points.size() << " obtained from 3D reconstruction" << endl;}
-
-    //if (saving){
-    //    CloudUtils::savePointsPly(cloud_rec, cloudsPathTo, saveName, numCloudsSaved);
-    //}
-
     return true;
 }
 
@@ -1982,27 +2562,28 @@ bool ToolIncorporator::getPointCloud(pcl::PointCloud<pcl::PointXYZRGB>::Ptr clou
 bool ToolIncorporator::findPoseAlign(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr modelCloud, pcl::PointCloud<pcl::PointXYZRGB>::Ptr poseCloud, Matrix &pose, const int numT)
 {
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rec (new pcl::PointCloud<pcl::PointXYZRGB> ());
-    Bottle cmdVis, replyVis;
+    int modelVersion = ++cloudVersion;     // The model is sent to the visualizer once, then only moved and recolored
     bool poseValid = false;
     int trial_align = 0;
     int trial_rec = 0;
 
-    cmdVis.clear();	replyVis.clear();
-    cmdVis.addString("accumClouds");
-    cmdVis.addInt(1);
-    rpcVisualizerPort.write(cmdVis,replyVis);
+    visualizer.accumulate(true);
     double spDist = 0.004;
 
     while (!poseValid){
+        if (cancelled()){
+            cout << "Pose estimation cancelled." << endl;
+            visualizer.accumulate(false);
+            return false;
+        }
+        stringstream trialMsg;
+        trialMsg << "alignment trial " << trial_align + 1 << " of " << numT + 1;
+        reportProgress((double)trial_align/(numT + 1.0), trialMsg.str());
 
-        // Set accumulator mode.
-        cmdVis.clear();	replyVis.clear();
-        cmdVis.addString("clearVis");
-        rpcVisualizerPort.write(cmdVis,replyVis);
+        // Clear the previous trial, it is sent along with the model cloud.
+        visualizer.clear();
 
-        Time::delay(1.0);
-        sendPointCloud(modelCloud);
-        Time::delay(1.0);
+        sendPointCloud(modelCloud, "model", modelVersion);
 
         // Get a registration
         turnHand(0,0, false);
@@ -2012,18 +2593,13 @@ bool ToolIncorporator::findPoseAlign(const pcl::PointCloud<pcl::PointXYZRGB>::Pt
             trial_rec++;
             cout << " Cloud not valid, retrial #" << trial_rec << endl;
             if (trial_rec > numT){
-                cmdVis.clear();	replyVis.clear();
-                cmdVis.addString("accumClouds");
-                cmdVis.addInt(0);
-                rpcVisualizerPort.write(cmdVis,replyVis);
-
+                visualizer.accumulate(false);
                 return false;
             }
             continue;
         }
         CloudUtils::changeCloudColor(cloud_rec, blue);             // Plot reconstructed view blue
         sendPointCloud(cloud_rec);
-        Time::delay(1.0);
 
         // Align it to the canonical model
         Eigen::Matrix4f alignMatrix;
@@ -2051,8 +2627,7 @@ bool ToolIncorporator::findPoseAlign(const pcl::PointCloud<pcl::PointXYZRGB>::Pt
         pcl::transformPointCloud(*modelCloud, *poseCloud, poseMatrix);
 
         CloudUtils::changeCloudColor(poseCloud, purple);
-        sendPointCloud(poseCloud);
-        Time::delay(1.0);
+        sendCloudUpdate(poseCloud, "model", modelVersion, purple, poseMatrix);
 
         if (!poseValid) {
             cout << "The estimated grasp is not possible, retry with a new pointcloud" << endl;
@@ -2064,19 +2639,13 @@ bool ToolIncorporator::findPoseAlign(const pcl::PointCloud<pcl::PointXYZRGB>::Pt
             cout << "Could not find a valid grasp in " << numT << "trials" << endl;
 
 
-            cmdVis.clear();	replyVis.clear();
-            cmdVis.addString("accumClouds");
-            cmdVis.addInt(0);
-            rpcVisualizerPort.write(cmdVis,replyVis);
+            visualizer.accumulate(false);
 
             return false;
         }
     }
 
-    cmdVis.clear();	replyVis.clear();
-    cmdVis.addString("accumClouds");
-    cmdVis.addInt(0);
-    rpcVisualizerPort.write(cmdVis,replyVis);
+    visualizer.accumulate(false);
 
     // Clean the depth visualization.
     Bottle cmdOR, replyOR;
@@ -2219,13 +2788,10 @@ bool ToolIncorporator::findSyms(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr clo
 {
 
     // Cloud can be strongly downsamlped to incrase speed in computation, shouldnt change much the results.
+    // Filtering, smoothing and downsampling are defined in 'pipe_sym'.
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZRGB> ());
     copyPointCloud(*cloud_raw, *cloud);
-
-    filterCloud(cloud_raw, cloud, 1);
-    smoothCloud(cloud, cloud, mls_rad, mls_usRad, mls_usStep);
-
-    CloudUtils::downsampleCloud(cloud, cloud, 0.005);
+    symPipe.process(cloud);
 
     sendPointCloud(cloud);
 
@@ -2344,7 +2910,6 @@ bool ToolIncorporator::findSyms(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr clo
             *cloudAB = *cloudA;
             *cloudAB += *cloudB;
             sendPointCloud(cloudAB);
-            Time::delay(1.5);
             cout << "Average  distance between two sides of the symmetry plane " << plane_i << " is " << sqrt(avgCloudKNNdist) << endl;
         }
     }
@@ -2391,7 +2956,6 @@ bool ToolIncorporator::findSyms(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr clo
     toolPlanesRaw.push_back(unitPlanes[effPlane_i]);       // X -> effector
     toolPlanesRaw.push_back(unitPlanes[hanPlane_i]);       // Y -> handle
     toolPlanesRaw.push_back(unitPlanes[symPlane_i]);       // Z -> symmetry
-    Time::delay(0.3);
     showRefFrame(center,toolPlanesRaw);
 
 
@@ -2480,7 +3044,6 @@ bool ToolIncorporator::findSyms(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr clo
         // ... and symmetry vector, to keep right-hand rule
         reverseVector(toolPlanes,2);  // Z [2] -> symmetry plane
         cout << "Effector sign changed"<< endl;
-        Time::delay(0.5);
         sendPointCloud(cloud_raw);
         showRefFrame(center,toolPlanes);
     } else{
@@ -2644,7 +3207,7 @@ bool ToolIncorporator::setToolPose(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr
 
 // XXX Remove all the get affordances part, now is taken care by affCollector XXX
 /************************************************************************/
-bool ToolIncorporator::getAffordances(Bottle &affBottle, bool allAffs)
+bool ToolIncorporator::getAffordances(const ToolState &state, Bottle &affBottle, bool allAffs)
 {
     cout << "Computing affordances of the tool-pose in hand " << endl;
     int numTools = 5;           // Change if the number of tools changes
@@ -2717,7 +3280,7 @@ bool ToolIncorporator::getAffordances(Bottle &affBottle, bool allAffs)
         }
     }else{          // Returns affordances of current tool-pose
 
-        if ((!cloudLoaded) || (!poseFound)){
+        if ((!state.cloudLoaded) || (!state.poseFound)){
             cout << "No tool loaded " << endl;
             affBottle.addString("no_aff");
             affBottle.addString("no_tool");
@@ -2726,7 +3289,7 @@ bool ToolIncorporator::getAffordances(Bottle &affBottle, bool allAffs)
 
         // Write the name of the tool in the bottle
         // Get index of tool pose in hand
-        int toolposeI = getTPindex(saveName, toolPose);
+        int toolposeI = getTPindex(state.toolName, state.toolPose);
         if (toolposeI < 0){
             cout << "Tool affordances not known " << endl;
             affBottle.addString("no_aff");
@@ -2735,7 +3298,7 @@ bool ToolIncorporator::getAffordances(Bottle &affBottle, bool allAffs)
         }
 
         // Get name of tool in hand
-        affBottle.addString(saveName);
+        affBottle.addString(state.toolName);
         Property &affProps = affBottle.addDict();
         toolAffMat = affMatrix.submatrix(toolposeI, toolposeI, 0 , cols-1); // Get affordance vector corresponding to current tool-pose
 
@@ -2866,19 +3429,25 @@ bool ToolIncorporator::extractFeats()
 
     poseFromParam(ori, displ, tilt, shift, feat_pose);
     setToolPose(cloud_model, feat_pose, cloud_feat);
-    sendPointCloud(cloud_feat);     // Send the oriented (non tilted) poincloud, TFE should receive it and make it its model.
-
-    Time::delay(0.5);
+    int featCloudSeq = sendPointCloud(cloud_feat);  // Send the oriented (non tilted) poincloud, TFE should receive it and make it its model.
+    cloudPublisher->flush();        // right away, it has to be there before the next commands
 
+    // Wait until TFE has received this very cloud, instead of giving it a fixed time
     Bottle cmdTFE, replyTFE;
+    if (cloudsOutPort.getOutputCount() > 0){
+        cmdTFE.clear();	replyTFE.clear();
+        cmdTFE.addString("waitCloud");
+        cmdTFE.addInt(featCloudSeq);
+        rpcFeatExtPort.write(cmdTFE,replyTFE);
+        if (!replyTFE.get(0).asBool())
+            cout << "Feature extractor did not receive cloud " << featCloudSeq << "." << endl;
+    }
+
     cmdTFE.clear();	replyTFE.clear();
     cmdTFE.addString("setName");
     cmdTFE.addString(saveName);
     rpcFeatExtPort.write(cmdTFE,replyTFE);
 
-    Time::delay(0.5);
-
-
 
     // Sends an RPC command to the toolFeatExt module to extract the 3D features of the merged point cloud/
 
@@ -3124,12 +3693,19 @@ bool ToolIncorporator::checkGrasp(const Matrix &pose)
 
 
 /************************************************************************/
-bool ToolIncorporator::frame2Hand(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_trans)
-{   // Normalizes the frame of the point cloud from the robot frame (as acquired) to the hand frame.
+bool ToolIncorporator::getHandTransform(Eigen::Matrix4f &R2H, const double t)
+{   // Computes the transformation from the robot frame (as acquired) to the hand frame, with the hand pose at time t (or the current one if t < 0).
 
     // Transform (translate-rotate) the pointcloud by inverting the hand pose
     Vector H2Rpos, H2Ror;
-    iCartCtrl->getPose(H2Rpos,H2Ror);
+    bool buffered = false;
+    if ((t > 0.0) && (poseBuffer != NULL)){
+        buffered = poseBuffer->getPoseAt(t, H2Rpos, H2Ror);
+        if (!buffered)
+            cout << "Hand pose at time " << t << " is not buffered, using the current one." << endl;
+    }
+    if (!buffered)
+        iCartCtrl->getPose(H2Rpos,H2Ror);
     Matrix H2R = axis2dcm(H2Ror);   // from axis/angle to rotation matrix notation
 
     // Include translation
@@ -3138,12 +3714,22 @@ bool ToolIncorporator::frame2Hand(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr c
     H2R(2,3)= H2Rpos[2];
     //if (verbose){ printf("Hand to robot transformatoin matrix (H2R):\n %s \n", H2R.toString().c_str());}
 
-    Matrix R2H = SE3inv(H2R);    //inverse the affine transformation matrix from robot to hand
-    //if (verbose){printf("Robot to Hand transformatoin matrix (R2H):\n %s \n", R2H.toString().c_str());}
+    Matrix R2Hyarp = SE3inv(H2R);    //inverse the affine transformation matrix from robot to hand
+    //if (verbose){printf("Robot to Hand transformatoin matrix (R2H):\n %s \n", R2Hyarp.toString().c_str());}
 
     // Put Transformation matrix into Eigen Format
-    Eigen::Matrix4f TM = CloudUtils::yarpMat2eigMat(R2H);
-    //cout << TM.matrix() << endl;
+    R2H = CloudUtils::yarpMat2eigMat(R2Hyarp);
+    //cout << R2H.matrix() << endl;
+
+    return true;
+}
+
+/************************************************************************/
+bool ToolIncorporator::frame2Hand(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_trans)
+{   // Normalizes the frame of the point cloud from the robot frame (as acquired) to the hand frame.
+
+    Eigen::Matrix4f TM;
+    getHandTransform(TM);
 
     // Executing the transformation
     pcl::transformPointCloud(*cloud_orig, *cloud_trans, TM);
@@ -3171,7 +3757,6 @@ bool ToolIncorporator::cloud2canonical(const pcl::PointCloud<pcl::PointXYZRGB>::
 
     pcl::transformPointCloud(*cloud_orig, *cloud_canon, tool2origin);
     sendPointCloud(cloud_canon);
-    Time::delay(0.5);
 
     // find lower point along handle axis (-Y), i.e. max on Y
     double dist_Y_max = 0.0;
@@ -3191,25 +3776,161 @@ bool ToolIncorporator::cloud2canonical(const pcl::PointCloud<pcl::PointXYZRGB>::
 
     pcl::transformPointCloud(*cloud_canon, *cloud_canon, handle_trans);
     sendPointCloud(cloud_canon);
-    Time::delay(0.5);
 
     return true;
 }
 
 /************************************************************************/
-bool ToolIncorporator::sendPointCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud)
+bool ToolIncorporator::getCameraIntrinsics()
 {
-    Bottle &cloudBottleOut = cloudsOutPort.prepare();
-    cloudBottleOut.clear();
-    
-    CloudUtils::cloud2bottle(cloud, cloudBottleOut);
-       
-    //if (verbose){cout << "Sending out cloud of size " << cloud->size()<< endl;}
-    cloudsOutPort.write();
+    // The gaze controller reports the projection matrix of each camera as 12 values, row-major
+    camIntrinsicsOK = false;
+    Bottle info;
+    if (!iGaze->getInfo(info))
+        return false;
+
+    Bottle *pIntr = info.find(("camera_intrinsics_" + camera).c_str()).asList();
+    if ((pIntr == NULL) || (pIntr->size() < 12))
+        return false;
+
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 4; c++)
+            camPrj(r,c) = pIntr->get(4*r + c).asDouble();
+
+    camIntrinsicsOK = true;
+    return true;
+}
+
+/************************************************************************/
+bool ToolIncorporator::projectToImage(const Matrix &H, const Vector &xe, const Vector &oe, const Eigen::Matrix<double,4,Eigen::Dynamic> &pts, Eigen::Matrix<double,2,Eigen::Dynamic> &px)
+{
+    // Projects points given in homogeneous coordinates on the frame H (root reference) onto the camera image,
+    // seen from the eye pose (xe, oe). All points are projected together with a single product.
+    if (!camIntrinsicsOK)
+        return false;
 
-    Time::delay(0.5);
+    Matrix He = axis2dcm(oe);
+    Vector xeH = xe;
+    xeH.push_back(1.0);
+    He.setCol(3, xeH);
+    Matrix H2eye = SE3inv(He)*H;
+
+    Eigen::Matrix4d T;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            T(r,c) = H2eye(r,c);
+
+    Eigen::Matrix<double,3,Eigen::Dynamic> p = (camPrj*T)*pts;
+    px.resize(2, pts.cols());
+    for (int i = 0; i < pts.cols(); i++){
+        px(0,i) = p(0,i)/p(2,i);
+        px(1,i) = p(1,i)/p(2,i);
+    }
     return true;
+}
+
+/************************************************************************/
+int ToolIncorporator::sendPointCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const string &visId, const int visVersion)
+{
+    //if (verbose){cout << "Sending out cloud of size " << cloud->size()<< endl;}
+    // Number the cloud, so that its display can be waited for. Clouds are also sent from the exploration thread,
+    // so numbering and sending go together, for both ports to get them in the same order.
+    sendMutex.lock();
+    cloudStamp.update();
+    int seq = cloudStamp.getCount();
+
+    // The visualizer gets it in the same message as the drawing commands queued before, so they are applied in order.
+    // Clouds given an id are kept by the visualizer, and their points are not sent again for the same version.
+    bool displayed = false;
+    if (visualizer.isConnected()){
+        visualizer.addCloud(cloud, visId, visVersion);
+        displayed = visualizer.flush(cloudStamp);
+    }
+
+    // On clouds:o it is only marked as the latest version, the publisher serializes it when due.
+    cloudPublisher->publish(cloud, cloudStamp);
+    sendMutex.unlock();
 
+    if (displayed)
+        waitDisplayed(seq);
+
+    return seq;     // so that receivers can be asked to wait for this very cloud
+}
+
+/************************************************************************/
+bool ToolIncorporator::sendCloudUpdate(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const string &visId, const int visVersion, int color[], const Eigen::Matrix4f &pose)
+{
+    // 'cloud' is the cloud sent with visId and visVersion, transformed by 'pose' and recolored. The visualizer only gets the pose and color
+    // to apply on the points it already has, unless it does not have them.
+    sendMutex.lock();
+    cloudStamp.update();
+    int seq = cloudStamp.getCount();
+
+    bool displayed = false;
+    if (visualizer.isConnected()){
+        if (!visualizer.updateCloud(visId, visVersion, color, pose))
+            visualizer.addCloud(cloud);
+        displayed = visualizer.flush(cloudStamp);
+    }
+
+    cloudPublisher->publish(cloud, cloudStamp);
+    sendMutex.unlock();
+
+    if (displayed)
+        waitDisplayed(seq);
+
+    return seq;     // so that receivers can be asked to wait for this very cloud
+}
+
+/************************************************************************/
+void ToolIncorporator::waitDisplayed(const int seq)
+{
+    // Wait until the visualizer has displayed the message numbered seq, so that what comes next is not drawn before it.
+    if ((!fast) && (rpcVisualizerPort.getOutputCount() > 0)){
+        Bottle cmdVis, replyVis;
+        cmdVis.addString("sync");
+        cmdVis.addInt(seq);
+        cmdVis.addDouble(visTimeout);
+        rpcVisualizerPort.write(cmdVis,replyVis);
+        if (!replyVis.get(0).asBool())
+            cout << "Visualizer did not display cloud " << seq << " within " << visTimeout << " s." << endl;
+    }
+}
+
+/************************************************************************/
+bool ToolIncorporator::flushVisualizer()
+{
+    // Sends the drawing commands queued since the last cloud, without waiting for them to be displayed.
+    sendMutex.lock();
+    cloudStamp.update();
+    bool sent = visualizer.flush(cloudStamp);
+    sendMutex.unlock();
+    return sent;
+}
+
+/************************************************************************/
+bool ToolIncorporator::waitArmStill(const double timeout)
+{   // Waits until the joints of the arm holding the tool have stopped moving (or timeout seconds have passed), so that views are taken with a steady tool.
+    IEncoders *ienc = NULL;
+    bool viewOK = (hand=="left") ? driverHL.view(ienc) : driverHR.view(ienc);
+    int nJoints = 0;
+    if ((!viewOK) || (ienc == NULL) || (!ienc->getAxes(&nJoints)) || (nJoints <= 0)){
+        cout << "Encoders of the " << hand << " arm not available, can not check whether it is still." << endl;
+        return false;
+    }
+    Vector speeds(nJoints, 0.0);
+
+    double t0 = Time::now();
+    while (Time::now() - t0 < timeout){
+        bool still = ienc->getEncoderSpeeds(speeds.data());
+        for (int j = 0; (j < nJoints) && still; j++)
+            still = fabs(speeds[j]) < 1.0;      // deg/s
+        if (still)
+            return true;
+        Time::delay(0.02);
+    }
+    cout << "Arm still moving after " << timeout << " s, proceeding." << endl;
+    return false;
 }
 
 
@@ -3218,21 +3939,7 @@ bool ToolIncorporator::sendPointCloud(const pcl::PointCloud<pcl::PointXYZRGB>::P
 bool ToolIncorporator::showTooltip(const Point3D coords, int color[])
 {
     cout << "Adding sphere at (" << coords.x << ", " << coords.y << ", " << coords.z << ") " << endl;
-    Time::delay (0.5);
-    Bottle cmdVis, replyVis;
-    cmdVis.clear();	replyVis.clear();
-    cmdVis.addString("addSphere");
-    Bottle& bCoords = cmdVis.addList();
-    bCoords.addDouble(coords.x);
-    bCoords.addDouble(coords.y);
-    bCoords.addDouble(coords.z);// - 0.03); //Compensate for the added 3 cm of displacemnt on Z point is also correct on pointcloud.
-    Bottle& bColor = cmdVis.addList();
-    bColor.addInt(color[0]);
-    bColor.addInt(color[1]);
-    bColor.addInt(color[2]);
-
-    rpcVisualizerPort.write(cmdVis,replyVis);
-
+    visualizer.addSphere(coords.x, coords.y, coords.z, color);   // Drawn along with the next cloud or batch sent to the visualizer
     return true;
 }
 
@@ -3255,104 +3962,24 @@ bool ToolIncorporator::showRefFrame(const Point3D center,const std::vector<Plane
 
 bool ToolIncorporator::showLine(const Point3D coordsIni, const  Point3D coordsEnd, int color[])
 {
-    Bottle cmdVis, replyVis;
-    cmdVis.clear();	replyVis.clear();
-    cmdVis.addString("addArrow");
-    Bottle& bCoordsIni = cmdVis.addList();
-    Bottle& bCoordsEnd = cmdVis.addList();
-    Bottle& bColor = cmdVis.addList();
-    bCoordsIni.clear();
-    bCoordsEnd.clear();
-    bColor.clear();
-
-    bCoordsIni.addDouble(coordsIni.x);
-    bCoordsIni.addDouble(coordsIni.y);
-    bCoordsIni.addDouble(coordsIni.z);
-
-    bCoordsEnd.addDouble(coordsEnd.x);
-    bCoordsEnd.addDouble(coordsEnd.y);
-    bCoordsEnd.addDouble(coordsEnd.z);
-
-    bColor.addInt(color[0]);
-    bColor.addInt(color[1]);
-    bColor.addInt(color[2]);
-
-    rpcVisualizerPort.write(cmdVis,replyVis);
+    visualizer.addArrow(coordsIni.x, coordsIni.y, coordsIni.z, coordsEnd.x, coordsEnd.y, coordsEnd.z, color);
     //cout << "Show line from  (" << coordsIni.x << ", " << coordsIni.y << ", " << coordsIni.z <<  ") to (" << coordsEnd.x << ", " << coordsEnd.y << ", " << coordsEnd.z <<  "). " << endl;
-    Time::delay(0.3);
     return true;
 }
 
 /************************************************************************/
-bool ToolIncorporator::filterCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filter, double thr)
+bool ToolIncorporator::filterCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filter)
 {
-    // Apply filtering to clean the cloud
-    // First of all, remove possible NaNs
-    std::vector<int> indices;
-    pcl::removeNaNFromPointCloud(*cloud_orig, *cloud_orig, indices);
-
-    // ... and removing outliers
-    pcl::RadiusOutlierRemoval<pcl::PointXYZRGB> ror; // -- by neighbours within radius
-    ror.setInputCloud(cloud_orig);
-    ror.setRadiusSearch(0.05);
-    ror.setMinNeighborsInRadius(50); //5
-    ror.filter(*cloud_filter);
-    cout << "--Size after rad out rem: " << cloud_filter->points.size() << "." << endl;
-
+    // Apply filtering to clean the cloud, as defined in the 'pipe_filter' group.
+    if (cloud_filter.get() != cloud_orig.get())
+        copyPointCloud(*cloud_orig, *cloud_filter);
 
-    pcl::StatisticalOutlierRemoval<pcl::PointXYZRGB> sor; //filter to remove outliers
-    sor.setStddevMulThresh (thr);
-    sor.setInputCloud (cloud_filter);
-    sor.setMeanK(10);
-    sor.filter (*cloud_filter);
-    cout << "--Size after Stat outrem: " << cloud_filter->points.size() << "." << endl;
-
-    //    if (verbose){ cout << " Cloud of size " << cloud_filter->points.size() << "after filtering." << endl;}
-
-    return true;
-}
-
-/************************************************************************/
-bool ToolIncorporator::smoothCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_orig, pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_smooth, double rad,double usRad, double usStep)
-{
-    // Perform Moving least squares to smooth surfaces
-    CloudUtils::downsampleCloud(cloud_orig, cloud_smooth, 0.005);
-
-    // XXX Dirty hack to do it with XYZ clouds. Check better ways (less conversions) to change XYZ <-> XYZRGB
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloudNoColor(new pcl::PointCloud<pcl::PointXYZ>);
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloudNoColorSmooth(new pcl::PointCloud<pcl::PointXYZ>);
-    copyPointCloud(*cloud_smooth, *cloudNoColor);
-    cout << "--Cloud copied: ." << endl;
-
-    //pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZRGB>);
-    //pcl::MovingLeastSquares<pcl::PointXYZRGB, pcl::PointXYZRGB> mls;
-    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
-
-    // Init object (second point type is for the normals, even if unused)
-    pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ> mls;
-    cout << "-- Setting mls..." << endl;
-    //    mls.setInputCloud (cloud_filter);
-    mls.setInputCloud(cloudNoColor);
-    mls.setSearchMethod(tree);
-    mls.setSearchRadius(rad);
-    mls.setPolynomialFit(true);
-    mls.setPolynomialOrder(1);
-    mls.setUpsamplingMethod(pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ>::SAMPLE_LOCAL_PLANE);
-    mls.setUpsamplingRadius(usRad);
-    mls.setUpsamplingStepSize(usStep);
-
-    cout << "-- Applying mls..." << endl;
-    mls.process(*cloudNoColorSmooth);
-    copyPointCloud(*cloudNoColorSmooth, *cloud_smooth);
-    //    mls.process (*cloud_filter);
-    CloudUtils::downsampleCloud(cloud_smooth, cloud_smooth, 0.001);
-    cout << "--Size after Mov leastsq: " << cloud_smooth->points.size() << "." << endl;
+    filterPipe.process(cloud_filter);
+    cout << "--Size after filtering: " << cloud_filter->points.size() << "." << endl;
 
     return true;
 }
 
-
-
 /*************************** -Conf Commands- ******************************/
 /************************************************************************/
 bool ToolIncorporator::changeSaveName(const string& fname)
@@ -3382,14 +4009,20 @@ bool ToolIncorporator::setVerbose(const string& verb)
 {
     if (verb == "ON"){
         verbose = true;
-        fprintf(stdout,"Verbose is : %s\n", verb.c_str());
-        return true;
     } else if (verb == "OFF"){
         verbose = false;
-        fprintf(stdout,"Verbose is : %s\n", verb.c_str());
-        return true;
+    } else {
+        return false;
     }
-    return false;
+    fprintf(stdout,"Verbose is : %s\n", verb.c_str());
+
+    // The pipelines print the stats of each run when verbose
+    recPipe.setVerbose(verbose);
+    mergePipe.setVerbose(verbose);
+    explorePipe.setVerbose(verbose);
+    filterPipe.setVerbose(verbose);
+    symPipe.setVerbose(verbose);
+    return true;
 }
 
 bool ToolIncorporator::showTipProj(const string& tipF)
@@ -3420,6 +4053,20 @@ bool ToolIncorporator::setSeg(const string& seg)
     return false;
 }
 
+bool ToolIncorporator::setFast(const string& fm)
+{
+    if (fm == "ON"){
+        fast = true;
+        cout << "Fast mode ON: not waiting for the visualizer." << endl;
+        return true;
+    } else if (fm == "OFF"){
+        fast = false;
+        cout << "Fast mode OFF: clouds are displayed before proceeding." << endl;
+        return true;
+    }
+    return false;
+}
+
 bool ToolIncorporator::setSaving(const string& sav)
 {
     if (sav == "ON"){
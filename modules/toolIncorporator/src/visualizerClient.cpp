@@ -0,0 +1,275 @@
+#include "visualizerClient.h"
+
+#include "iCub/YarpCloud/CloudUtils.h"
+
+using namespace std;
+using namespace yarp::os;
+using namespace iCub::YarpCloud;
+
+// Constructor
+VisualizerClient::VisualizerClient(): reconnected(false), batchReady(0), reporter(*this) {}
+
+void VisualizerClient::ConnectionReporter::report(const PortInfo &info)
+{
+    if ((info.tag == PortInfo::PORTINFO_CONNECTION) && (!info.incoming)){
+        client.mutex.lock();
+        client.reconnected = true;
+        client.mutex.unlock();
+    }
+}
+
+// Forget the clouds the visualizer had if it has been reconnected since (with the mutex locked)
+void VisualizerClient::checkConnections()
+{
+    if (reconnected){
+        sentVersions.clear();
+        reconnected = false;
+    }
+}
+
+// Write the flushed batches, in order
+void VisualizerClient::run()
+{
+    while (!isStopping())
+    {
+        batchReady.wait();
+        if (isStopping())
+            break;
+
+        mutex.lock();
+        if (outgoing.empty()){      // dropped while waiting
+            mutex.unlock();
+            continue;
+        }
+        Batch b = outgoing.front();
+        outgoing.pop_front();
+        mutex.unlock();
+
+        write(b);
+    }
+}
+
+// Unblock the thread so it can be stopped
+void VisualizerClient::onStop()
+{
+    batchReady.post();
+}
+
+bool VisualizerClient::open(const string &portName)
+{
+    port.setReporter(reporter);
+    return port.open(portName.c_str()) && start();
+}
+
+void VisualizerClient::interrupt()
+{
+    port.interrupt();
+}
+
+void VisualizerClient::close()
+{
+    stop();
+    port.close();
+}
+
+bool VisualizerClient::isConnected()
+{
+    return port.getOutputCount() > 0;
+}
+
+void VisualizerClient::clear()
+{
+    mutex.lock();
+    batch.commands.addList().addString("clear");
+    mutex.unlock();
+}
+
+void VisualizerClient::accumulate(const bool accum)
+{
+    mutex.lock();
+    Bottle &cmd = batch.commands.addList();
+    cmd.addString("accum");
+    cmd.addInt(accum ? 1 : 0);
+    mutex.unlock();
+}
+
+void VisualizerClient::addCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud, const string &id, const int version)
+{
+    mutex.lock();
+    checkConnections();
+    Bottle &cmd = batch.commands.addList();
+    map<string, int>::iterator sent = sentVersions.find(id);
+    if ((!id.empty()) && (sent != sentVersions.end()) && (sent->second == version)){
+        // Already there, display it again as it was
+        cmd.addString("update");
+        cmd.addString(id);
+        cmd.addInt(version);
+    }else{
+        cmd.addString("cloud");
+        cmd.addList();
+        batch.clouds.push_back(pcl::PointCloud<pcl::PointXYZRGB>::Ptr (new pcl::PointCloud<pcl::PointXYZRGB> (*cloud)));
+        if (!id.empty()){
+            cmd.addString(id);
+            cmd.addInt(version);
+            sentVersions[id] = version;
+        }
+    }
+    mutex.unlock();
+}
+
+bool VisualizerClient::updateCloud(const string &id, const int version, const int color[], const Eigen::Matrix4f &pose)
+{
+    mutex.lock();
+    checkConnections();
+    map<string, int>::iterator sent = sentVersions.find(id);
+    if ((sent == sentVersions.end()) || (sent->second != version)){
+        mutex.unlock();
+        return false;
+    }
+
+    Bottle &cmd = batch.commands.addList();
+    cmd.addString("update");
+    cmd.addString(id);
+    cmd.addInt(version);
+    Bottle &bColor = cmd.addList();
+    bColor.addString("color");
+    Bottle &bRGB = bColor.addList();
+    bRGB.addInt(color[0]);
+    bRGB.addInt(color[1]);
+    bRGB.addInt(color[2]);
+    Bottle &bPose = cmd.addList();
+    bPose.addString("pose");
+    Bottle &bMat = bPose.addList();
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            bMat.addDouble(pose(r,c));
+    mutex.unlock();
+    return true;
+}
+
+void VisualizerClient::addSphere(const double x, const double y, const double z, const int color[])
+{
+    mutex.lock();
+    Bottle &cmd = batch.commands.addList();
+    cmd.addString("sphere");
+    Bottle &bCoords = cmd.addList();
+    bCoords.addDouble(x);
+    bCoords.addDouble(y);
+    bCoords.addDouble(z);
+    Bottle &bColor = cmd.addList();
+    bColor.addInt(color[0]);
+    bColor.addInt(color[1]);
+    bColor.addInt(color[2]);
+    mutex.unlock();
+}
+
+void VisualizerClient::addArrow(const double xIni, const double yIni, const double zIni,
+                                const double xEnd, const double yEnd, const double zEnd, const int color[])
+{
+    mutex.lock();
+    Bottle &cmd = batch.commands.addList();
+    cmd.addString("arrow");
+    Bottle &bCoordsIni = cmd.addList();
+    bCoordsIni.addDouble(xIni);
+    bCoordsIni.addDouble(yIni);
+    bCoordsIni.addDouble(zIni);
+    Bottle &bCoordsEnd = cmd.addList();
+    bCoordsEnd.addDouble(xEnd);
+    bCoordsEnd.addDouble(yEnd);
+    bCoordsEnd.addDouble(zEnd);
+    Bottle &bColor = cmd.addList();
+    bColor.addInt(color[0]);
+    bColor.addInt(color[1]);
+    bColor.addInt(color[2]);
+    mutex.unlock();
+}
+
+bool VisualizerClient::flush(const Stamp &stamp)
+{
+    mutex.lock();
+    if ((batch.commands.size() == 0) || (port.getOutputCount() == 0)){
+        // A visualizer connected later will not have the clouds sent so far
+        if (port.getOutputCount() == 0)
+            sentVersions.clear();
+        batch.commands.clear();
+        batch.clouds.clear();
+        mutex.unlock();
+        return false;
+    }
+
+    batch.stamp = stamp;
+    outgoing.push_back(batch);
+    batch.commands.clear();
+    batch.clouds.clear();
+
+    // Each batch holds copies of its clouds, so only a few are kept waiting for a visualizer that falls behind
+    while (outgoing.size() > maxQueued)
+        dropOldest();
+    mutex.unlock();
+
+    batchReady.post();
+    return true;
+}
+
+// Drop the oldest batch waiting (with the mutex locked). The visualizer will miss its drawings, but the last version of
+// each identified cloud in it is carried over to the next batch, as later commands may refer to it.
+void VisualizerClient::dropOldest()
+{
+    Batch old = outgoing.front();
+    outgoing.pop_front();
+
+    Bottle carried;
+    vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr> carriedClouds;
+    size_t c = 0;
+    for (int i = 0; (i < old.commands.size()) && (c < old.clouds.size()); i++)
+    {
+        Bottle *cmd = old.commands.get(i).asList();
+        if ((cmd == NULL) || (cmd->get(0).asString() != "cloud"))
+            continue;
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = old.clouds[c++];
+        if (cmd->size() < 3)        // not identified, nothing refers to it
+            continue;
+
+        // A newer version replaces the one carried so far
+        string id = cmd->get(2).asString();
+        for (int k = 0; k < carried.size(); k++)
+        {
+            if (carried.get(k).asList()->get(2).asString() == id){
+                *carried.get(k).asList() = *cmd;
+                carriedClouds[k] = cloud;
+                id.clear();
+                break;
+            }
+        }
+        if (!id.empty()){
+            carried.addList() = *cmd;
+            carriedClouds.push_back(cloud);
+        }
+    }
+    if (carried.size() == 0)
+        return;
+
+    Batch &next = outgoing.front();
+    carried.append(next.commands);
+    carriedClouds.insert(carriedClouds.end(), next.clouds.begin(), next.clouds.end());
+    next.commands = carried;
+    next.clouds = carriedClouds;
+}
+
+// Serialize the clouds of a batch into its message and send it (on the writer thread)
+void VisualizerClient::write(Batch &b)
+{
+    Bottle &msg = port.prepare();
+    msg = b.commands;
+    size_t c = 0;
+    for (int i = 0; (i < msg.size()) && (c < b.clouds.size()); i++)
+    {
+        Bottle *cmd = msg.get(i).asList();
+        if ((cmd != NULL) && (cmd->get(0).asString() == "cloud") && cmd->get(1).isList())
+            CloudUtils::cloud2bottle(b.clouds[c++], *cmd->get(1).asList());
+    }
+
+    // Strict, so that no batch is dropped while the previous one is still being sent.
+    port.setEnvelope(b.stamp);
+    port.writeStrict();
+}
@@ -0,0 +1,68 @@
+/*
+ * CENTER PORT MONITOR for on-the-wire data reduction
+ * Copyright (C) 2015 iCub Facility - Istituto Italiano di Tecnologia
+ * Author: Tanis Mar
+ * email: tanis.mar@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef __CENTERMONITOR_H__
+#define __CENTERMONITOR_H__
+
+// Includes
+#include <string>
+
+#include <yarp/os/MonitorObject.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/Things.h>
+
+/**
+ * @brief The CenterMonitor class is a compiled port monitor, which replaces the former center_pm.lua script.
+ * It runs on the receiving side of a connection, e.g.
+ *      yarp connect /blobs:o /toolIncorporator/pts2D:i tcp+recv.portmonitor+type.dll+file.center_pm
+ *      yarp connect /obj3Drec/pnt:o /toolIncorporator/clouds:i tcp+recv.portmonitor+type.dll+file.center_pm+mode.cloud+step.2
+ * Modes:
+ *  - center (default): replaces a list of blob bounding boxes ((tlx tly brx bry) ...) by the center (cx cy) of the first one.
+ *  - cloud: reduces a cloud in the CloudUtils::cloud2bottle format, keeping one of every 'step' points and,
+ *    if any of xmin, xmax, ymin, ymax, zmin, zmax is given, only those inside that box.
+ * Parameters can be given on the carrier string or changed at runtime through setparam.
+ */
+class CenterMonitor : public yarp::os::MonitorObject
+{
+protected:
+    enum Mode { MODE_CENTER, MODE_CLOUD };
+
+    Mode                mode;
+    int                 step;           // decimation: keep one every 'step' points
+    bool                crop;           // whether to crop the cloud to the box
+    double              boxMin[3];
+    double              boxMax[3];
+
+    yarp::os::Bottle    out;            // reduced message, delivered instead of the received one
+
+    void configure(const yarp::os::Searchable &params);
+
+public:
+    CenterMonitor();
+
+    virtual bool create(const yarp::os::Property &options);
+    virtual void destroy();
+    virtual bool setparam(const yarp::os::Property &params);
+    virtual bool getparam(yarp::os::Property &params);
+    virtual bool accept(yarp::os::Things &thing);
+    virtual yarp::os::Things& update(yarp::os::Things &thing);
+};
+
+#endif
+
@@ -0,0 +1,122 @@
+#include "centerMonitor.h"
+
+#include <iostream>
+#include <yarp/os/SharedLibraryClass.h>
+
+using namespace std;
+using namespace yarp::os;
+
+// Factory the portmonitor carrier looks for when loading the library (type.dll)
+YARP_DEFINE_SHARED_SUBCLASS(MonitorObject_there, CenterMonitor, MonitorObject);
+
+// Constructor
+CenterMonitor::CenterMonitor(): mode(MODE_CENTER), step(1), crop(false)
+{
+    boxMin[0] = boxMin[1] = boxMin[2] = -1e9;
+    boxMax[0] = boxMax[1] = boxMax[2] = 1e9;
+}
+
+bool CenterMonitor::create(const Property &options)
+{
+    configure(options);
+    cout << "center_pm created in " << ((mode == MODE_CLOUD) ? "cloud" : "center") << " mode." << endl;
+    return true;
+}
+
+void CenterMonitor::destroy()
+{
+    out.clear();
+}
+
+bool CenterMonitor::setparam(const Property &params)
+{
+    configure(params);
+    return true;
+}
+
+bool CenterMonitor::getparam(Property &params)
+{
+    params.put("mode", (mode == MODE_CLOUD) ? "cloud" : "center");
+    params.put("step", step);
+    if (crop){
+        params.put("xmin", boxMin[0]);  params.put("xmax", boxMax[0]);
+        params.put("ymin", boxMin[1]);  params.put("ymax", boxMax[1]);
+        params.put("zmin", boxMin[2]);  params.put("zmax", boxMax[2]);
+    }
+    return true;
+}
+
+void CenterMonitor::configure(const Searchable &params)
+{
+    if (params.check("mode"))
+        mode = (params.find("mode").asString() == "cloud") ? MODE_CLOUD : MODE_CENTER;
+    if (params.check("step"))
+        step = (params.find("step").asInt() > 1) ? params.find("step").asInt() : 1;
+
+    const char *minKeys[3] = {"xmin", "ymin", "zmin"};
+    const char *maxKeys[3] = {"xmax", "ymax", "zmax"};
+    for (int d = 0; d < 3; d++){
+        if (params.check(minKeys[d])){
+            boxMin[d] = params.find(minKeys[d]).asDouble();
+            crop = true;
+        }
+        if (params.check(maxKeys[d])){
+            boxMax[d] = params.find(maxKeys[d]).asDouble();
+            crop = true;
+        }
+    }
+}
+
+// Drop the messages that can not be reduced, instead of delivering them malformed
+bool CenterMonitor::accept(Things &thing)
+{
+    Bottle *bt = thing.cast_as<Bottle>();
+    if (bt == NULL)
+        return false;
+
+    if (mode == MODE_CENTER){
+        Bottle *blob = bt->get(0).asList();
+        return (blob != NULL) && (blob->size() >= 4);
+    }
+    return true;
+}
+
+Things& CenterMonitor::update(Things &thing)
+{
+    Bottle *bt = thing.cast_as<Bottle>();
+
+    if (mode == MODE_CENTER){
+        // Center of the bounding box of the first blob
+        Bottle *blob = bt->get(0).asList();
+        int cx = (blob->get(0).asInt() + blob->get(2).asInt()) / 2;
+        int cy = (blob->get(1).asInt() + blob->get(3).asInt()) / 2;
+        bt->clear();
+        bt->addInt(cx);
+        bt->addInt(cy);
+        return thing;
+    }
+
+    // Cloud: decimate and crop, point by point on the bottle, without converting it to a PCL cloud
+    if ((step == 1) && (!crop))
+        return thing;
+
+    out.clear();
+    for (int i = 0; i < bt->size(); i += step)
+    {
+        Bottle *point = bt->get(i).asList();
+        if ((point == NULL) || (point->size() < 3))
+            continue;
+        if (crop){
+            bool inside = true;
+            for (int d = 0; (d < 3) && inside; d++){
+                double v = point->get(d).asDouble();
+                inside = (v >= boxMin[d]) && (v <= boxMax[d]);
+            }
+            if (!inside)
+                continue;
+        }
+        out.addList() = *point;
+    }
+    thing.setPortWriter(&out);
+    return thing;
+}